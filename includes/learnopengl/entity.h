@@ -2,9 +2,16 @@
 #define ENTITY_H
 
 #include <glm/glm.hpp> //glm::mat4
+#include <glm/gtc/matrix_transform.hpp> //glm::rotate
 #include <list> //std::list
 #include <array> //std::array
 #include <memory> //std::unique_ptr
+#include <limits> //std::numeric_limits
+#include <algorithm> //std::min, std::max
+#include <cmath> //std::abs, tanf
+
+#include <learnopengl/camera.h>
+#include <learnopengl/model.h>
 
 class Transform
 {
@@ -65,7 +72,7 @@ public:
 		m_isDirty = true;
 	}
 
-	const glm::vec3& getGlobalPosition() const
+	glm::vec3 getGlobalPosition() const
 	{
 		return m_modelMatrix[3];
 	}
@@ -171,6 +178,8 @@ struct BoundingVolume
 
 struct Sphere : public BoundingVolume
 {
+	using BoundingVolume::isOnFrustum; //world space test, no transform
+
 	glm::vec3 center{ 0.f, 0.f, 0.f };
 	float radius{ 0.f };
 
@@ -209,6 +218,8 @@ struct Sphere : public BoundingVolume
 
 struct SquareAABB : public BoundingVolume
 {
+	using BoundingVolume::isOnFrustum; //world space test, no transform
+
 	glm::vec3 center{ 0.f, 0.f, 0.f };
 	float extent{ 0.f };
 
@@ -258,6 +269,8 @@ struct SquareAABB : public BoundingVolume
 
 struct AABB : public BoundingVolume
 {
+	using BoundingVolume::isOnFrustum; //world space test, no transform
+
 	glm::vec3 center{ 0.f, 0.f, 0.f };
 	glm::vec3 extents{ 0.f, 0.f, 0.f };
 
@@ -326,7 +339,7 @@ struct AABB : public BoundingVolume
 	};
 };
 
-Frustum createFrustumFromCamera(const Camera& cam, float aspect, float fovY, float zNear, float zFar)
+inline Frustum createFrustumFromCamera(const Camera& cam, float aspect, float fovY, float zNear, float zFar)
 {
 	Frustum     frustum;
 	const float halfVSide = zFar * tanf(fovY * .5f);
@@ -342,10 +355,10 @@ Frustum createFrustumFromCamera(const Camera& cam, float aspect, float fovY, flo
 	return frustum;
 }
 
-AABB generateAABB(const Model& model)
+inline AABB generateAABB(const Model& model)
 {
 	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
+	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::lowest());
 	for (auto&& mesh : model.meshes)
 	{
 		for (auto&& vertex : mesh.vertices)
@@ -362,10 +375,10 @@ AABB generateAABB(const Model& model)
 	return AABB(minAABB, maxAABB);
 }
 
-Sphere generateSphereBV(const Model& model)
+inline Sphere generateSphereBV(const Model& model)
 {
 	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
+	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::lowest());
 	for (auto&& mesh : model.meshes)
 	{
 		for (auto&& vertex : mesh.vertices)
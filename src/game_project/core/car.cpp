@@ -1,6 +1,17 @@
 #include "car.h"
 #include <btBulletDynamicsCommon.h>
 #include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Blend between two angles in degrees the shorter way around
+  float lerpAngle(float from, float to, float t)
+  {
+    float delta = std::fmod(to - from + 540.0f, 360.0f) - 180.0f;
+    return from + delta * t;
+  }
+}
 
 void Car::syncFromPhysics()
 {
@@ -28,6 +39,56 @@ void Car::syncFromPhysics()
   }
 }
 
+void Car::saveState(State &out) const
+{
+  PhysicsWorld::saveBody(rigidBody, out.body);
+  out.position = position;
+  out.yaw = yaw;
+  out.pitch = pitch;
+  out.roll = roll;
+  out.velocity = velocity;
+  out.previousPosition = previousPosition;
+  out.previousYaw = previousYaw;
+  out.previousPitch = previousPitch;
+  out.previousRoll = previousRoll;
+  out.fuel = fuel;
+  out.turbo = turbo;
+  out.wheelsInContact = wheelsInContact;
+}
+
+void Car::restoreState(const State &state, PhysicsWorld &world)
+{
+  world.restoreBody(rigidBody, state.body);
+  position = state.position;
+  yaw = state.yaw;
+  pitch = state.pitch;
+  roll = state.roll;
+  velocity = state.velocity;
+  previousPosition = state.previousPosition;
+  previousYaw = state.previousYaw;
+  previousPitch = state.previousPitch;
+  previousRoll = state.previousRoll;
+  fuel = state.fuel;
+  turbo = state.turbo;
+  wheelsInContact = state.wheelsInContact;
+}
+
+void Car::beginTick()
+{
+  previousPosition = position;
+  previousYaw = yaw;
+  previousPitch = pitch;
+  previousRoll = roll;
+}
+
+void Car::interpolate(float alpha)
+{
+  renderPosition = previousPosition + (position - previousPosition) * alpha;
+  renderYaw = lerpAngle(previousYaw, yaw, alpha);
+  renderPitch = lerpAngle(previousPitch, pitch, alpha);
+  renderRoll = lerpAngle(previousRoll, roll, alpha);
+}
+
 void Car::updateFuel(float deltaTime, bool isMoving)
 {
   if (isMoving && fuel > 0.0f)
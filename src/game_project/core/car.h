@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "../physics/PhysicsWorld.h"
+
 // Forward declaration to avoid header conflicts between Bullet and Assimp
 class btRigidBody;
 class btTransform;
@@ -13,6 +15,19 @@ class btQuaternion;
 class Car
 {
 public:
+  // Everything a simulation tick changes, for rewinding (see GameSession::rewindTo)
+  struct State
+  {
+    PhysicsWorld::BodyState body;
+    glm::vec3 position;
+    float yaw, pitch, roll, velocity;
+    glm::vec3 previousPosition;
+    float previousYaw, previousPitch, previousRoll;
+    float fuel;
+    float turbo;
+    int wheelsInContact;
+  };
+
   glm::vec3 position{0.0f};
   float yaw = -90.0f;
   float pitch = 0.0f;
@@ -23,6 +38,17 @@ public:
   float displayYaw = -90.0f;
   float displayPitch = 0.0f;
   float displayRoll = 0.0f;
+
+  // State at the start of the latest simulation tick, and the state drawn this frame,
+  // interpolated between the two so motion stays smooth whatever the frame rate
+  glm::vec3 previousPosition{0.0f};
+  float previousYaw = -90.0f;
+  float previousPitch = 0.0f;
+  float previousRoll = 0.0f;
+  glm::vec3 renderPosition{0.0f};
+  float renderYaw = -90.0f;
+  float renderPitch = 0.0f;
+  float renderRoll = 0.0f;
   
   // Fuel system
   float fuel = 100.0f;          // Current fuel percentage (0-100)
@@ -37,9 +63,20 @@ public:
 
   // Bullet physics rigid body
   btRigidBody *rigidBody = nullptr;
+  // Wheels whose ray reached the ground on the last physics tick
+  int wheelsInContact = 0;
 
   // Sync position and rotation from Bullet rigid body
   void syncFromPhysics();
+
+  void saveState(State &out) const;
+  // Return to a saved state, rigid body included; the display angles are left to catch up
+  void restoreState(const State &state, PhysicsWorld &world);
+
+  // Remember the current state before a simulation tick changes it
+  void beginTick();
+  // Set the render state between the last two ticks (alpha 0 = previous tick, 1 = latest)
+  void interpolate(float alpha);
   
   // Update fuel (depletes over time when moving)
   void updateFuel(float deltaTime, bool isMoving);
@@ -65,15 +102,15 @@ public:
     // Smooth interpolation for visual orientation
     float t = glm::clamp(lerpSpeed * deltaTime, 0.0f, 1.0f);
     
-    displayYaw = displayYaw + (yaw - displayYaw) * t;
-    displayPitch = displayPitch + (pitch - displayPitch) * t;
-    displayRoll = displayRoll + (roll - displayRoll) * t;
+    displayYaw = displayYaw + (renderYaw - displayYaw) * t;
+    displayPitch = displayPitch + (renderPitch - displayPitch) * t;
+    displayRoll = displayRoll + (renderRoll - displayRoll) * t;
   }
   
   glm::mat4 getModelMatrix() const
   {
     glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, position);
+    model = glm::translate(model, renderPosition);
     model = glm::rotate(model, glm::radians(displayYaw), glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::rotate(model, glm::radians(displayPitch), glm::vec3(1.0f, 0.0f, 0.0f));
     model = glm::rotate(model, glm::radians(displayRoll), glm::vec3(0.0f, 0.0f, 1.0f));
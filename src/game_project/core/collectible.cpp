@@ -1,14 +1,8 @@
 #include "collectible.h"
-#include <glad/glad.h>
+#include <algorithm>
 #include <cstdlib>
-#include <ctime>
 #include <cmath>
-#include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <learnopengl/model.h>
-#include <learnopengl/filesystem.h>
 #include "../scene/Terrain.h"
 
 static const int ITEM_SEGMENTS = 32;
@@ -17,12 +11,63 @@ static const float BASE_HALF_HEIGHT = 0.05f;
 static const float DEFAULT_SCALE = 0.75f;
 
 Collectibles::Collectibles()
+    : collectionHistory(COLLECTION_HISTORY)
 {
 }
 
-void Collectibles::init()
+void Collectibles::init(unsigned int seed)
 {
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));
+    // PCG32 seeding: step once from the increment plus the seed
+    rngState = 0;
+    nextRandom();
+    rngState += seed;
+    nextRandom();
+}
+
+void Collectibles::saveSnapshot(Snapshot &out) const
+{
+    out.itemCount = static_cast<int>(items.size());
+    out.collections = collections;
+    out.rngState = rngState;
+}
+
+bool Collectibles::restoreSnapshot(const Snapshot &snapshot)
+{
+    if (collections - snapshot.collections > static_cast<uint64_t>(COLLECTION_HISTORY))
+        return false;
+
+    // Un-collect before dropping the new items: some of the pickups may be among them
+    for (uint64_t n = snapshot.collections; n < collections; ++n)
+        items[collectionHistory[n % COLLECTION_HISTORY]].collected = false;
+    collections = snapshot.collections;
+
+    // Items only ever grow, so this shrinks (without reallocating) or keeps the count
+    if (snapshot.itemCount < static_cast<int>(items.size()))
+        items.erase(items.begin() + snapshot.itemCount, items.end());
+
+    rngState = snapshot.rngState;
+    return true;
+}
+
+uint32_t Collectibles::nextRandom()
+{
+    // PCG32 (XSH RR): the same sequence on every platform, and the whole state is one word
+    uint64_t old = rngState;
+    rngState = old * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint32_t xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+    uint32_t rot = static_cast<uint32_t>(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+float Collectibles::random01()
+{
+    // Top 24 bits: exact in a float
+    return (nextRandom() >> 8) * (1.0f / 16777216.0f);
+}
+
+int Collectibles::randomPercent()
+{
+    return static_cast<int>(nextRandom() % 100);
 }
 
 glm::vec3 Collectibles::getColor(CollectibleType type)
@@ -57,6 +102,11 @@ float Collectibles::getScale(CollectibleType type)
     }
 }
 
+float Collectibles::getBaseLift(CollectibleType type)
+{
+    return BASE_HALF_HEIGHT * getScale(type);
+}
+
 int Collectibles::getDefaultValue(CollectibleType type)
 {
     switch (type) {
@@ -114,9 +164,9 @@ void Collectibles::spawnItem(const glm::vec3 &position, CollectibleType type)
     item.value = getDefaultValue(type);
     item.color = getColor(type);
     
-    item.bobAmplitude = 0.04f + (std::rand() / (float)RAND_MAX) * 0.08f; // 0.04 - 0.12
-    item.bobFrequency = 2.0f + (std::rand() / (float)RAND_MAX) * 3.0f;   // 2 - 5
-    item.bobPhase = (std::rand() / (float)RAND_MAX) * 2.0f * (float)M_PI;
+    item.bobAmplitude = 0.04f + random01() * 0.08f; // 0.04 - 0.12
+    item.bobFrequency = 2.0f + random01() * 3.0f;   // 2 - 5
+    item.bobPhase = random01() * 2.0f * (float)M_PI;
     
     items.push_back(item);
 }
@@ -132,16 +182,16 @@ void Collectibles::spawnRandom(int count, CollectibleType type)
     const float desiredFaceHeight = 1.0f;
 
     for (int i = 0; i < count; ++i) {
-        float x = (std::rand() / (float)RAND_MAX) * 60.0f - 20.0f;
-        float z = (std::rand() / (float)RAND_MAX) * 60.0f - 20.0f;
+        float x = random01() * 60.0f - 20.0f;
+        float z = random01() * 60.0f - 20.0f;
         
         CollectibleType itemType = type;
         // For coins, randomly make some rare
-        if (type == CollectibleType::COIN && (std::rand() % 100) < 20) {
+        if (type == CollectibleType::COIN && randomPercent() < 20) {
             itemType = CollectibleType::COIN_RARE;
         }
         
-        const float baseLift = BASE_HALF_HEIGHT * getScale(itemType);
+        const float baseLift = getBaseLift(itemType);
         const float yOffset = getYOffset(itemType);
         const float storedY = desiredFaceHeight - baseLift + yOffset;
         
@@ -162,25 +212,35 @@ void Collectibles::spawnAlongDirection(int count, const glm::vec3 &origin, const
     glm::vec3 f = glm::normalize(glm::vec3(forward.x, 0.0f, forward.z));
     glm::vec3 right = glm::normalize(glm::vec3(-f.z, 0.0f, f.x));
 
+    // Place the items first (height relative to the ground), then lift them all by one batched terrain query
+    const size_t first = items.size();
+    std::vector<float> xs(count);
+    std::vector<float> zs(count);
     for (int i = 0; i < count; ++i) {
-        float along = minForward + (std::rand() / (float)RAND_MAX) * (maxForward - minForward);
-        float lateral = ((std::rand() / (float)RAND_MAX) - 0.5f) * lateralRange;
+        float along = minForward + random01() * (maxForward - minForward);
+        float lateral = (random01() - 0.5f) * lateralRange;
 
         glm::vec3 pos = origin + f * along + right * lateral;
-        float sampledY = 1.0f;
-        if (terrain) {
-            sampledY = terrain->getHeight(pos.x, pos.z);
-        }
+        xs[i] = pos.x;
+        zs[i] = pos.z;
         
         CollectibleType itemType = type;
-        if (type == CollectibleType::COIN && (std::rand() % 100) < 20) {
+        if (type == CollectibleType::COIN && randomPercent() < 20) {
             itemType = CollectibleType::COIN_RARE;
         }
         
-        const float baseLift = BASE_HALF_HEIGHT * getScale(itemType);
+        const float baseLift = getBaseLift(itemType);
         const float yOffset = getYOffset(itemType);
         
-        spawnItem(glm::vec3(pos.x, sampledY + baseLift + yOffset, pos.z), itemType);
+        spawnItem(glm::vec3(pos.x, baseLift + yOffset, pos.z), itemType);
+    }
+
+    std::vector<float> sampledY(count, 1.0f);
+    if (terrain && count > 0) {
+        terrain->sampleHeights(xs.data(), zs.data(), count, sampledY.data());
+    }
+    for (int i = 0; i < count; ++i) {
+        items[first + i].position.y += sampledY[i];
     }
 }
 
@@ -192,17 +252,17 @@ void Collectibles::spawnMixedGroup(int coinCount, const glm::vec3 &origin, const
     spawnAlongDirection(coinCount, origin, forward, terrain, CollectibleType::COIN, minForward, maxForward, lateralRange);
     
     // Probabilistically spawn rare coin
-    if (rareCoinChance > 0 && (std::rand() % 100) < rareCoinChance) {
+    if (rareCoinChance > 0 && randomPercent() < rareCoinChance) {
         spawnAlongDirection(1, origin, forward, terrain, CollectibleType::COIN_RARE, minForward, maxForward, lateralRange);
     }
     
     // Probabilistically spawn turbo
-    if (turboChance > 0 && (std::rand() % 100) < turboChance) {
+    if (turboChance > 0 && randomPercent() < turboChance) {
         spawnAlongDirection(1, origin, forward, terrain, CollectibleType::TURBO, minForward, maxForward, lateralRange);
     }
     
     // Probabilistically spawn fuel
-    if (fuelChance > 0 && (std::rand() % 100) < fuelChance) {
+    if (fuelChance > 0 && randomPercent() < fuelChance) {
         spawnAlongDirection(1, origin, forward, terrain, CollectibleType::FUEL, minForward, maxForward, lateralRange);
     }
 }
@@ -277,6 +337,7 @@ int Collectibles::updateCollect(const glm::vec3 &carPos, float carRadius, const
             if (dot < minDot) continue;
 
             items[i].collected = true;
+            collectionHistory[collections++ % COLLECTION_HISTORY] = static_cast<uint32_t>(i);
             outCollected.push_back(items[i]);
             newly += items[i].value;
         }
@@ -291,73 +352,3 @@ int Collectibles::remaining() const
         if (!items[i].collected) ++rem;
     return rem;
 }
-
-void Collectibles::draw(Shader &shader, unsigned int fallbackTexture)
-{
-    for (size_t i = 0; i < items.size(); ++i) {
-        if (items[i].collected) continue;
-        
-        glm::mat4 m(1.0f);
-        float t = static_cast<float>(glfwGetTime());
-
-        float bounce = sinf(t * items[i].bobFrequency + items[i].bobPhase) * items[i].bobAmplitude;
-        float bounceAbs = fabsf(bounce);
-        float scale = getScale(items[i].type);
-        float baseLift = BASE_HALF_HEIGHT * scale;
-        m = glm::translate(m, items[i].position + glm::vec3(0.0f, baseLift + bounceAbs, 0.0f));
-
-        m = glm::rotate(m, glm::radians(0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        float spin = t * 180.0f;
-        m = glm::rotate(m, glm::radians(spin), glm::vec3(0.0f, 1.0f, 0.0f));
-        m = glm::scale(m, glm::vec3(scale));
-
-        shader.setMat4("model", m);
-        
-        // Use specific model for this item type, or fallback to COIN model
-        Model* modelToUse = nullptr;
-        CollectibleType typeForModel = items[i].type;
-        
-        // Rare coins use the same model as regular coins (just different color)
-        if (typeForModel == CollectibleType::COIN_RARE) {
-            typeForModel = CollectibleType::COIN;
-        }
-        
-        auto it = models.find(typeForModel);
-        if (it != models.end()) {
-            modelToUse = it->second;
-        } else {
-            // Fallback to COIN model if specific model not found
-            auto fallbackIt = models.find(CollectibleType::COIN);
-            if (fallbackIt != models.end()) {
-                modelToUse = fallbackIt->second;
-            }
-        }
-        
-        // Determine if this item type should use color override or model's own materials
-        bool useColorOverride = (items[i].type == CollectibleType::COIN || 
-                                 items[i].type == CollectibleType::COIN_RARE);
-        
-        if (useColorOverride) {
-            // For coins: use simple texture with color override
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, fallbackTexture);
-            shader.setInt("texture_diffuse1", 0);
-            shader.setBool("useColor", true);
-            shader.setVec3("objectColor", items[i].color);
-        } else {
-            // For other models (fuel, turbo): use their embedded materials
-            shader.setBool("useColor", false);
-            glBindTexture(GL_TEXTURE_2D, 0);
-        }
-        
-        if (modelToUse) {
-            modelToUse->Draw(shader);
-        }
-        
-        // Reset state after drawing
-        shader.setBool("useColor", false);
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
-    
-    glBindVertexArray(0);
-}
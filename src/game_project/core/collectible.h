@@ -4,9 +4,8 @@
 #include <vector>
 #include <map>
 #include <glm/glm.hpp>
-#include <learnopengl/shader_m.h>
-#include <learnopengl/model.h>
 #include <memory>
+#include <cstdint>
 
 class Terrain;
 
@@ -30,8 +29,18 @@ struct CollectibleItem {
 
 class Collectibles {
 public:
+    // Restoring un-collects the items picked up since the snapshot, found in a ring of the
+    // last COLLECTION_HISTORY pickups; a snapshot with more pickups after it can't be restored
+    static constexpr int COLLECTION_HISTORY = 4096;
+    struct Snapshot {
+        int itemCount;
+        uint64_t collections; // pickups so far
+        uint64_t rngState;
+    };
+
     Collectibles();
-    void init();
+    // Seed the generator behind every random spawn position, type and bob; a seed replays the same items
+    void init(unsigned int seed);
     void spawnRandom(int count, CollectibleType type = CollectibleType::COIN);
     void spawnAlongDirection(int count, const glm::vec3 &origin, const glm::vec3 &forward, 
                             const Terrain *terrain, CollectibleType type = CollectibleType::COIN,
@@ -42,24 +51,38 @@ public:
                         int fuelChance = 5);
     int updateCollect(const glm::vec3 &carPos, float carRadius, const glm::vec3 &carForward, 
                      float carSpeed, std::vector<CollectibleItem> &outCollected);
-    void draw(Shader &shader, unsigned int fallbackTexture);
     int remaining() const;
     int totalCount() const;
     bool hasItemsInDirection(const glm::vec3 &origin, const glm::vec3 &forward,
                             float minForward, float maxForward, float lateralRange, 
                             int minCount = 1, CollectibleType type = CollectibleType::COIN) const;
-    void setModel(CollectibleType type, Model *m) { models[type] = m; }
+    // Every spawned item, collected ones included; drawn by CollectibleRenderer
+    const std::vector<CollectibleItem> &getItems() const { return items; }
+    void saveSnapshot(Snapshot &out) const;
+    // Drop items spawned since the snapshot, un-collect those picked up since and put the
+    // generator back. False, with nothing changed, when the pickups since overflow the history.
+    bool restoreSnapshot(const Snapshot &snapshot);
     static glm::vec3 getColor(CollectibleType type);
     static float getScale(CollectibleType type);
+    // Height of the item's base above the ground it was placed on
+    static float getBaseLift(CollectibleType type);
     static int getDefaultValue(CollectibleType type);
     static float getYOffset(CollectibleType type);
     static int getMaxSpawnCount(CollectibleType type);
     
 private:
-    std::map<CollectibleType, Model*> models;
     std::vector<CollectibleItem> items;
+    // Indices of collected items in pickup order, entry n % COLLECTION_HISTORY for pickup n
+    std::vector<uint32_t> collectionHistory;
+    uint64_t collections = 0;
+    // PCG32 state: small enough to snapshot every tick
+    uint64_t rngState = 0;
     
     void spawnItem(const glm::vec3 &position, CollectibleType type);
+    uint32_t nextRandom();
+    // Uniform in [0, 1), and an integer in [0, 100)
+    float random01();
+    int randomPercent();
 };
 
 #endif
@@ -0,0 +1,141 @@
+#include "controls_log.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+
+namespace
+{
+  const char MAGIC[4] = {'N', 'C', 'L', 'G'};
+  const uint32_t VERSION = 2;
+
+  // Fixed little-endian layout, whatever the host
+  void putU32(std::vector<uint8_t> &out, uint32_t v)
+  {
+    for (int i = 0; i < 4; ++i)
+      out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+  }
+  void putF32(std::vector<uint8_t> &out, float f)
+  {
+    uint32_t v;
+    std::memcpy(&v, &f, sizeof(v));
+    putU32(out, v);
+  }
+  uint32_t getU32(const uint8_t *in)
+  {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+  }
+  float getF32(const uint8_t *in)
+  {
+    uint32_t v = getU32(in);
+    float f;
+    std::memcpy(&f, &v, sizeof(f));
+    return f;
+  }
+
+  const size_t HEADER_BYTES = 4 + 4 + 4 + 4 + 4; // magic, version, seed, tick rate, run count
+  const size_t RUN_BYTES = 5;
+  const size_t RESULT_BYTES = 5 * 4;
+}
+
+void ControlsLog::begin(unsigned int s, float rate)
+{
+  seed = s;
+  tickRate = rate;
+  tickCount = 0;
+  runs.clear();
+  result = Result();
+}
+
+void ControlsLog::record(const Controls &controls)
+{
+  const uint8_t bits = pack(controls);
+  if (runs.empty() || runs.back().controls != bits || runs.back().ticks == UINT32_MAX)
+    runs.push_back({0, bits});
+  runs.back().ticks++;
+  tickCount++;
+}
+
+uint8_t ControlsLog::pack(const Controls &controls)
+{
+  int steer = controls.steer < 0 ? 0 : (controls.steer > 0 ? 2 : 1);
+  return static_cast<uint8_t>((controls.throttle ? 1 : 0) | (controls.brake ? 2 : 0) | (controls.boost ? 4 : 0) | (steer << 3));
+}
+
+Controls ControlsLog::unpack(uint8_t bits)
+{
+  Controls controls;
+  controls.throttle = (bits & 1) != 0;
+  controls.brake = (bits & 2) != 0;
+  controls.boost = (bits & 4) != 0;
+  controls.steer = ((bits >> 3) & 3) - 1;
+  return controls;
+}
+
+bool ControlsLog::save(const std::string &path) const
+{
+  std::vector<uint8_t> out;
+  out.reserve(HEADER_BYTES + runs.size() * RUN_BYTES + RESULT_BYTES);
+  out.insert(out.end(), MAGIC, MAGIC + 4);
+  putU32(out, VERSION);
+  putU32(out, seed);
+  putF32(out, tickRate);
+  putU32(out, static_cast<uint32_t>(runs.size()));
+  for (const Run &run : runs)
+  {
+    putU32(out, run.ticks);
+    out.push_back(run.controls);
+  }
+  putU32(out, result.ticks);
+  putU32(out, static_cast<uint32_t>(result.score));
+  putF32(out, result.x);
+  putF32(out, result.y);
+  putF32(out, result.z);
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file.write(reinterpret_cast<const char *>(out.data()), out.size()))
+  {
+    std::cerr << "ControlsLog::save: could not write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool ControlsLog::load(const std::string &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+  {
+    std::cerr << "ControlsLog::load: could not open " << path << std::endl;
+    return false;
+  }
+  std::vector<uint8_t> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (in.size() < HEADER_BYTES || std::memcmp(in.data(), MAGIC, 4) != 0 || getU32(&in[4]) != VERSION)
+  {
+    std::cerr << "ControlsLog::load: " << path << " is not a controls log" << std::endl;
+    return false;
+  }
+  const uint32_t runCount = getU32(&in[16]);
+  if (in.size() != HEADER_BYTES + static_cast<size_t>(runCount) * RUN_BYTES + RESULT_BYTES)
+  {
+    std::cerr << "ControlsLog::load: " << path << " is truncated" << std::endl;
+    return false;
+  }
+
+  begin(getU32(&in[8]), getF32(&in[12]));
+  const uint8_t *p = &in[HEADER_BYTES];
+  runs.resize(runCount);
+  for (Run &run : runs)
+  {
+    run.ticks = getU32(p);
+    run.controls = p[4];
+    tickCount += run.ticks;
+    p += RUN_BYTES;
+  }
+  result.ticks = getU32(p);
+  result.score = static_cast<int32_t>(getU32(p + 4));
+  result.x = getF32(p + 8);
+  result.y = getF32(p + 12);
+  result.z = getF32(p + 16);
+  return true;
+}
@@ -0,0 +1,60 @@
+#ifndef GAME_PROJECT_CONTROLS_LOG_H
+#define GAME_PROJECT_CONTROLS_LOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "controls.h"
+
+// The controls of every tick of one deterministic game, run-length encoded, with the seed and
+// tick rate it ran at and how it ended. Replaying the runs into a GameSession started the same
+// way reproduces the result bit for bit.
+class ControlsLog
+{
+public:
+  // 'ticks' consecutive ticks with the same controls, packed as by pack()
+  struct Run
+  {
+    uint32_t ticks = 0;
+    uint8_t controls = 0;
+  };
+  // State after the last recorded tick
+  struct Result
+  {
+    uint32_t ticks = 0;
+    int32_t score = 0;
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+  };
+
+  // Clear the log for a new game
+  void begin(unsigned int seed, float tickRate);
+  void record(const Controls &controls);
+  void setResult(const Result &r) { result = r; }
+
+  // Binary file: header, runs of 5 bytes, result. False (with a message on stderr) on I/O
+  // errors or a file that is not a controls log.
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
+
+  unsigned int getSeed() const { return seed; }
+  float getTickRate() const { return tickRate; }
+  uint32_t getTickCount() const { return tickCount; }
+  const std::vector<Run> &getRuns() const { return runs; }
+  const Result &getResult() const { return result; }
+
+  // Throttle, brake and boost in bits 0-2, steer + 1 in bits 3-4
+  static uint8_t pack(const Controls &controls);
+  static Controls unpack(uint8_t bits);
+
+private:
+  unsigned int seed = 0;
+  float tickRate = 120.0f;
+  uint32_t tickCount = 0;
+  std::vector<Run> runs;
+  Result result;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "game_session.h"
+#include "../physics/physics.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+GameSession::GameSession() {}
+GameSession::~GameSession() {}
+
+bool GameSession::start(unsigned int terrainSeed)
+{
+  // Procedural terrain (width, depth, scale, heightScale, seed): a coarse render grid,
+  // plus a 0.4 m physics corridor 24 m wide and 192 m long around the car
+  terrain.setPhysicsCorridor(12.0f, 96.0f, 5);
+  if (!terrain.init(128, 800, 2.0f, 3.5f, terrainSeed))
+  {
+    std::cerr << "GameSession::start: terrain initialization failed" << std::endl;
+    return false;
+  }
+
+  score = 0;
+  gameOver = false;
+  time = 0.0f;
+  distanceTraveled = 0.0f;
+
+  // The world is reused from game to game; reset() returns the car's body to its pool
+  world.reset();
+  car = Car();
+  Physics::initializeCar(car, world, car.position);
+  startPosition = car.position;
+
+  collectibles = Collectibles();
+  collectibles.init(terrainSeed ^ 0x9e3779b9u);
+  // initial spawn: fewer coins spread further ahead of the car along its forward direction
+  glm::vec3 initialForward = glm::vec3(std::cos(glm::radians(car.yaw)), 0.0f, std::sin(glm::radians(car.yaw)));
+  collectibles.spawnAlongDirection(6, car.position, initialForward, &terrain, CollectibleType::COIN, 8.0f, 25.0f, 1.8f);
+  lastSpawnPos = car.position;
+  lastSpawnTime = 0.0f;
+  tickCount = 0;
+  firstSnapshotTick = 0;
+  saveSnapshot();
+  return true;
+}
+
+void GameSession::tick(float dt, Controls controls)
+{
+  if (gameOver || !car.rigidBody)
+    return;
+
+  // Only allow boost if turbo is available
+  if (controls.boost && !car.hasTurbo())
+    controls.boost = false;
+
+  car.beginTick();
+  Physics::updateCar(car, dt, controls, world, &terrain);
+  time += dt;
+
+  // Update distance traveled (horizontal distance from start)
+  glm::vec3 horizontalDelta = car.position - startPosition;
+  horizontalDelta.y = 0.0f;
+  distanceTraveled = glm::length(horizontalDelta);
+
+  // Progressive difficulty: terrain gets steeper over distance
+  // Difficulty increases by 0.1 every 100 meters, capped at 2.5x
+  float terrainDifficulty = 1.0f + (distanceTraveled / 100.0f) * 0.1f;
+  terrainDifficulty = std::min(terrainDifficulty, 2.5f);
+  terrain.setDifficultyMultiplier(terrainDifficulty);
+
+  // Update terrain for infinite generation, prefetching along the car's heading
+  float headingRad = glm::radians(car.yaw);
+  terrain.update(car.position.x, car.position.z, car.velocity * std::cos(headingRad), car.velocity * std::sin(headingRad));
+
+  collect();
+
+  // Update turbo usage (depletes when boost is active)
+  if (controls.boost && car.hasTurbo())
+    car.useTurbo(dt);
+
+  // Update fuel depletion
+  bool isMoving = (controls.throttle || controls.brake || controls.steer != 0);
+  car.updateFuel(dt, isMoving);
+
+  // Check for game over conditions
+  if (car.isOutOfFuel())
+    gameOver = true;
+  else
+    spawn();
+
+  tickCount++;
+  saveSnapshot();
+}
+
+void GameSession::setRewindCapacity(int ticks)
+{
+  snapshots.assign(std::max(ticks, 0), Snapshot());
+  snapshots.shrink_to_fit();
+  firstSnapshotTick = tickCount;
+  if (car.rigidBody)
+    saveSnapshot();
+}
+
+uint32_t GameSession::getOldestRewindTick() const
+{
+  const uint32_t capacity = static_cast<uint32_t>(snapshots.size());
+  if (capacity == 0)
+    return tickCount;
+  return std::max(firstSnapshotTick, tickCount >= capacity ? tickCount - capacity + 1 : 0u);
+}
+
+void GameSession::saveSnapshot()
+{
+  if (snapshots.empty())
+    return;
+  Snapshot &snapshot = snapshots[tickCount % snapshots.size()];
+  car.saveState(snapshot.car);
+  collectibles.saveSnapshot(snapshot.collectibles);
+  snapshot.score = score;
+  snapshot.gameOver = gameOver;
+  snapshot.time = time;
+  snapshot.distanceTraveled = distanceTraveled;
+  snapshot.lastSpawnPos = lastSpawnPos;
+  snapshot.lastSpawnTime = lastSpawnTime;
+}
+
+bool GameSession::rewindTo(uint32_t tick)
+{
+  if (snapshots.empty() || !car.rigidBody || tick > tickCount || tick < getOldestRewindTick())
+    return false;
+
+  const Snapshot &snapshot = snapshots[tick % snapshots.size()];
+  if (!collectibles.restoreSnapshot(snapshot.collectibles))
+    return false;
+  car.restoreState(snapshot.car, world);
+  score = snapshot.score;
+  gameOver = snapshot.gameOver;
+  time = snapshot.time;
+  distanceTraveled = snapshot.distanceTraveled;
+  lastSpawnPos = snapshot.lastSpawnPos;
+  lastSpawnTime = snapshot.lastSpawnTime;
+  // Slots of ticks before the oldest reachable one now hold ticks after `tick`, and stay lost
+  firstSnapshotTick = getOldestRewindTick();
+  tickCount = tick;
+  return true;
+}
+
+void GameSession::collect()
+{
+  glm::vec3 forwardDir = glm::vec3(std::cos(glm::radians(car.yaw)), 0.0f, std::sin(glm::radians(car.yaw)));
+  std::vector<CollectibleItem> collected;
+  int newly = collectibles.updateCollect(car.position, 1.0f, forwardDir, car.velocity, collected);
+  if (newly <= 0)
+    return;
+
+  score += newly;
+  if (logEvents)
+    std::cout << "Collected " << collected.size() << " items. Remaining: " << collectibles.remaining() << "  Total Score: " << score << std::endl;
+  // Handle different item types
+  for (const auto &item : collected)
+  {
+    switch (item.type)
+    {
+    case CollectibleType::COIN:
+    case CollectibleType::COIN_RARE:
+      // Already added to score
+      break;
+    case CollectibleType::TURBO:
+      car.addTurbo(static_cast<float>(item.value));
+      if (logEvents)
+        std::cout << "  Turbo collected! +" << item.value << "% (Now: " << car.getTurboPercent() << "%)" << std::endl;
+      break;
+    case CollectibleType::FUEL:
+      car.addFuel(item.value);
+      if (logEvents)
+        std::cout << "  Fuel refilled! +" << item.value << "% (Now: " << car.getFuelPercent() << "%)" << std::endl;
+      break;
+    }
+  }
+}
+
+void GameSession::spawn()
+{
+  // Controlled respawn: spawn coins as the player moves forward in their facing direction
+  glm::vec3 forwardDir = glm::vec3(std::cos(glm::radians(car.yaw)), 0.0f, std::sin(glm::radians(car.yaw)));
+
+  // Progressive difficulty: spawn less frequently and fewer items over distance
+  // Cooldown increases from 1.0s to 3.0s over 500m
+  float progressiveCooldown = 1.0f + (distanceTraveled / 500.0f) * 2.0f;
+  progressiveCooldown = std::min(progressiveCooldown, 3.0f);
+
+  // Spawn count decreases from 6 to 2 over 500m
+  int progressiveSpawnCount = static_cast<int>(6 - (distanceTraveled / 500.0f) * 4.0f);
+  progressiveSpawnCount = std::max(progressiveSpawnCount, 2);
+
+  // compute how much the player moved forward along their facing direction since last spawn
+  glm::vec3 delta = car.position - lastSpawnPos;
+  glm::vec3 deltaXZ = glm::vec3(delta.x, 0.0f, delta.z);
+  float forwardMoved = glm::dot(glm::normalize(glm::vec3(forwardDir.x, 0.0f, forwardDir.z)), glm::normalize(glm::length(deltaXZ) > 0.0001f ? deltaXZ : glm::vec3(0.0f))) * glm::length(deltaXZ);
+  const float spawnForwardThreshold = 4.0f; // spawn when we've moved this far forward
+
+  // Only spawn when moving forward and respecting progressive cooldown
+  if (forwardMoved <= spawnForwardThreshold || (time - lastSpawnTime) <= progressiveCooldown)
+    return;
+
+  // Check whether there are already coins in the forward sector; if so, don't spawn more
+  const float checkMinF = 4.0f;
+  const float checkMaxF = 20.0f;
+  const float checkLat = 2.5f;
+  if (collectibles.hasItemsInDirection(car.position, forwardDir, checkMinF, checkMaxF, checkLat, 1, CollectibleType::COIN))
+    return;
+
+  const float spawnMinF = 8.0f;
+  const float spawnMaxF = 30.0f;
+  const float spawnLat = 1.8f;
+  collectibles.spawnMixedGroup(progressiveSpawnCount, car.position, forwardDir, &terrain,
+                               spawnMinF, spawnMaxF, spawnLat, 20, 20, 20);
+
+  lastSpawnPos = car.position;
+  lastSpawnTime = time;
+}
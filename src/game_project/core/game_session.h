@@ -0,0 +1,96 @@
+#ifndef GAME_PROJECT_GAME_SESSION_H
+#define GAME_PROJECT_GAME_SESSION_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "car.h"
+#include "collectible.h"
+#include "controls.h"
+#include "../physics/PhysicsWorld.h"
+#include "../scene/Terrain.h"
+
+// One game without any rendering: the terrain, the physics world, the car, the collectibles
+// and the fuel/turbo rules, advanced one fixed tick at a time. The game draws it between
+// ticks; the headless simulation just ticks it.
+class GameSession
+{
+public:
+  GameSession();
+  ~GameSession();
+
+  // Start a new game; terrainSeed also seeds where collectibles spawn
+  bool start(unsigned int terrainSeed);
+  // Advance the game by one tick of dt seconds. Boost is ignored while the car has no turbo.
+  void tick(float dt, Controls controls);
+
+  // Build terrain windows inline on the ticking thread instead of on a worker, so the game
+  // depends only on its seed and the controls of each tick (see ControlsLog). Costs a hitch
+  // on the ticks that build one. Applied at the next start().
+  void setDeterministic(bool enabled) { terrain.setAsyncGeneration(!enabled); }
+  // Keep the state after each of the last `ticks` ticks so rewindTo() can go back to any of
+  // them (0 turns this off). The ring is allocated here, once; each tick then copies a few
+  // hundred bytes into it without allocating. Clears what the ring held.
+  void setRewindCapacity(int ticks);
+  // Go back to the state right after tick `tick` (0 = just after start()). Ticks after it are
+  // forgotten, and ticking again overwrites them. Terrain is not rewound: it streams back
+  // around the car, and craters made since stay. False, with nothing changed, if the tick is not
+  // in the ring or more items were collected since than Collectibles keeps track of.
+  bool rewindTo(uint32_t tick);
+  // Ticks run since start(), and the oldest tick rewindTo() can still reach
+  uint32_t getTick() const { return tickCount; }
+  uint32_t getOldestRewindTick() const;
+  size_t getRewindBytes() const { return snapshots.capacity() * sizeof(Snapshot); }
+  // Print pickups to stdout as they happen
+  void setLogEvents(bool enabled) { logEvents = enabled; }
+
+  Car &getCar() { return car; }
+  const Car &getCar() const { return car; }
+  Terrain &getTerrain() { return terrain; }
+  const Collectibles &getCollectibles() const { return collectibles; }
+  int getScore() const { return score; }
+  bool isGameOver() const { return gameOver; }
+  // Horizontal distance from the start, and simulated seconds since start()
+  float getDistanceTraveled() const { return distanceTraveled; }
+  float getTime() const { return time; }
+
+private:
+  // Everything that changes from tick to tick, apart from the terrain
+  struct Snapshot
+  {
+    Car::State car;
+    Collectibles::Snapshot collectibles;
+    int score;
+    bool gameOver;
+    float time;
+    float distanceTraveled;
+    glm::vec3 lastSpawnPos;
+    float lastSpawnTime;
+  };
+
+  void collect();
+  void spawn();
+  void saveSnapshot();
+
+  Terrain terrain;
+  PhysicsWorld world;
+  Car car;
+  Collectibles collectibles;
+
+  int score = 0;
+  bool gameOver = false;
+  bool logEvents = false;
+  float time = 0.0f;
+  float distanceTraveled = 0.0f;
+  glm::vec3 startPosition{0.0f};
+  glm::vec3 lastSpawnPos{0.0f};
+  float lastSpawnTime = 0.0f;
+
+  uint32_t tickCount = 0;
+  // Snapshot of tick t at index t % size, for the ticks since firstSnapshotTick
+  std::vector<Snapshot> snapshots;
+  uint32_t firstSnapshotTick = 0;
+};
+
+#endif
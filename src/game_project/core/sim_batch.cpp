@@ -0,0 +1,144 @@
+#include "sim_batch.h"
+#include <algorithm>
+#include <cmath>
+
+SimBatch::SimBatch(int threadCount)
+{
+  if (threadCount <= 0)
+    threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  for (int i = 1; i < threadCount; ++i)
+    workers.emplace_back(&SimBatch::workerLoop, this);
+}
+
+SimBatch::~SimBatch()
+{
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    quit = true;
+  }
+  startCv.notify_all();
+  for (std::thread &worker : workers)
+    worker.join();
+}
+
+void SimBatch::workerLoop()
+{
+  unsigned int seen = 0;
+  std::unique_lock<std::mutex> lock(poolMutex);
+  while (true)
+  {
+    startCv.wait(lock, [&]
+                 { return quit || generation != seen; });
+    if (quit)
+      return;
+    seen = generation;
+
+    lock.unlock();
+    runTasks();
+    lock.lock();
+    if (--busyWorkers == 0)
+      doneCv.notify_one();
+  }
+}
+
+void SimBatch::runTasks()
+{
+  // Environments are handed out one at a time, so a slow one (say, a terrain rebuild) does not
+  // hold up a whole share of the batch
+  const int count = size();
+  for (int env = nextEnv.fetch_add(1); env < count; env = nextEnv.fetch_add(1))
+    (*task)(env);
+}
+
+void SimBatch::parallelFor(const std::function<void(int)> &fn)
+{
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    task = &fn;
+    nextEnv.store(0);
+    busyWorkers = static_cast<int>(workers.size());
+    generation++;
+  }
+  startCv.notify_all();
+  runTasks();
+
+  std::unique_lock<std::mutex> lock(poolMutex);
+  doneCv.wait(lock, [this]
+              { return busyWorkers == 0; });
+  task = nullptr;
+}
+
+bool SimBatch::reset(int count, unsigned int firstSeed, bool asyncTerrain)
+{
+  sessions.clear();
+  for (int i = 0; i < count; ++i)
+  {
+    sessions.push_back(std::make_unique<GameSession>());
+    sessions.back()->getTerrain().setAsyncGeneration(asyncTerrain);
+  }
+
+  observations.positionX.assign(count, 0.0f);
+  observations.positionY.assign(count, 0.0f);
+  observations.positionZ.assign(count, 0.0f);
+  observations.yaw.assign(count, 0.0f);
+  observations.velocity.assign(count, 0.0f);
+  observations.fuel.assign(count, 0.0f);
+  observations.turbo.assign(count, 0.0f);
+  observations.score.assign(count, 0);
+  observations.gameOver.assign(count, 0);
+  observations.profile.assign(count * PROFILE_POINTS, 0.0f);
+
+  std::atomic<bool> ok{true};
+  parallelFor([&](int env)
+              {
+                if (!sessions[env]->start(firstSeed + env))
+                  ok = false;
+                observe(env); });
+  return ok;
+}
+
+bool SimBatch::restart(int env, unsigned int seed)
+{
+  bool ok = sessions[env]->start(seed);
+  observe(env);
+  return ok;
+}
+
+void SimBatch::step(float dt, const Controls *controls)
+{
+  parallelFor([&](int env)
+              {
+                sessions[env]->tick(dt, controls[env]);
+                observe(env); });
+}
+
+void SimBatch::observe(int env)
+{
+  GameSession &session = *sessions[env];
+  const Car &car = session.getCar();
+  observations.positionX[env] = car.position.x;
+  observations.positionY[env] = car.position.y;
+  observations.positionZ[env] = car.position.z;
+  observations.yaw[env] = car.yaw;
+  observations.velocity[env] = car.velocity;
+  observations.fuel[env] = car.getFuelPercent();
+  observations.turbo[env] = car.getTurboPercent();
+  observations.score[env] = session.getScore();
+  observations.gameOver[env] = session.isGameOver();
+
+  // One batched height query per environment for the profile ahead
+  const float headingRad = glm::radians(car.yaw);
+  const float dirX = std::cos(headingRad);
+  const float dirZ = std::sin(headingRad);
+  float x[PROFILE_POINTS];
+  float z[PROFILE_POINTS];
+  for (int k = 0; k < PROFILE_POINTS; ++k)
+  {
+    x[k] = car.position.x + dirX * PROFILE_SPACING * (k + 1);
+    z[k] = car.position.z + dirZ * PROFILE_SPACING * (k + 1);
+  }
+  float *profile = &observations.profile[env * PROFILE_POINTS];
+  session.getTerrain().sampleHeights(x, z, PROFILE_POINTS, profile);
+  for (int k = 0; k < PROFILE_POINTS; ++k)
+    profile[k] -= car.position.y;
+}
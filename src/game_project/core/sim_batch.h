@@ -0,0 +1,83 @@
+#ifndef GAME_PROJECT_SIM_BATCH_H
+#define GAME_PROJECT_SIM_BATCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "controls.h"
+#include "game_session.h"
+
+// Many independent games (each with its own terrain, physics world, car and collectibles)
+// stepped together. Each step spreads the environments over a fixed pool of threads and
+// writes observations into structure-of-arrays buffers, one entry per environment.
+class SimBatch
+{
+public:
+  // Heights sampled ahead of each car, PROFILE_SPACING apart along its heading
+  static constexpr int PROFILE_POINTS = 16;
+  static constexpr float PROFILE_SPACING = 2.0f;
+
+  struct Observations
+  {
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    std::vector<float> yaw;      // degrees
+    std::vector<float> velocity; // forward speed
+    std::vector<float> fuel;     // percent
+    std::vector<float> turbo;    // percent
+    std::vector<int> score;
+    std::vector<char> gameOver;
+    // PROFILE_POINTS terrain heights per environment, relative to the car's height:
+    // profile[env * PROFILE_POINTS + k] is k + 1 steps ahead
+    std::vector<float> profile;
+  };
+
+  // threadCount 0 = one per hardware thread; the calling thread is one of them
+  explicit SimBatch(int threadCount = 0);
+  ~SimBatch();
+  SimBatch(const SimBatch &) = delete;
+  SimBatch &operator=(const SimBatch &) = delete;
+
+  // Start count environments in parallel; environment i gets terrain seed firstSeed + i.
+  // Terrain windows are built inline on the pool threads rather than by one worker thread
+  // per environment, unless asyncTerrain is set.
+  bool reset(int count, unsigned int firstSeed, bool asyncTerrain = false);
+  // Start a new game in one environment, e.g. after it reports gameOver
+  bool restart(int env, unsigned int seed);
+  // Advance every environment by one tick of dt seconds, environment i with controls[i],
+  // then refresh the observations. Environments whose game is over stand still.
+  void step(float dt, const Controls *controls);
+
+  int size() const { return static_cast<int>(sessions.size()); }
+  int getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+  const Observations &getObservations() const { return observations; }
+  GameSession &getSession(int env) { return *sessions[env]; }
+
+private:
+  // Run task(i) for every environment i on the pool and the calling thread; returns when all are done
+  void parallelFor(const std::function<void(int)> &task);
+  void runTasks();
+  void workerLoop();
+  void observe(int env);
+
+  std::vector<std::unique_ptr<GameSession>> sessions;
+  Observations observations;
+
+  std::vector<std::thread> workers;
+  std::mutex poolMutex;
+  std::condition_variable startCv;
+  std::condition_variable doneCv;
+  const std::function<void(int)> *task = nullptr;
+  std::atomic<int> nextEnv{0};
+  unsigned int generation = 0; // bumped for each parallelFor; workers wait for a new one
+  int busyWorkers = 0;
+  bool quit = false;
+};
+
+#endif
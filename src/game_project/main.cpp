@@ -18,14 +18,14 @@
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
-#include "core/collectible.h"
-#include "core/car.h"
+#include "core/game_session.h"
+#include "core/controls_log.h"
 #include "core/controls.h"
 #include "core/callbacks.h"
 #include "physics/physics.h"
-#include "physics/PhysicsWorld.h"
 #include "input/input.h"
 #include "scene/scene.h"
+#include "scene/CollectibleRenderer.h"
 #include "ui/GameUI.h"
 
 const unsigned int SCR_WIDTH = 800;
@@ -37,16 +37,35 @@ float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
 Controls controls;
-Car car;
-Collectibles collectibles;
+GameSession session;
 GameUI gameUI;
 
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 bool gameOver = false;
 
-int main()
+// Options:
+//   --seed N       terrain and collectible seed of the first game (later games count up from it)
+//   --record FILE  play deterministically and write each game's controls to FILE for
+//                  nitro_sim_cli --replay (the file holds the most recent game)
+int main(int argc, char **argv)
 {
+  bool fixedSeed = false;
+  unsigned int firstSeed = 0;
+  std::string recordPath;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    if (std::string(argv[i]) == "--seed")
+    {
+      fixedSeed = true;
+      firstSeed = static_cast<unsigned int>(std::stoul(argv[i + 1]));
+    }
+    else if (std::string(argv[i]) == "--record")
+    {
+      recordPath = argv[i + 1];
+    }
+  }
+
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -84,36 +103,26 @@ int main()
   // Initialize UI
   gameUI.init(SCR_WIDTH, SCR_HEIGHT);
 
+  // The game session builds terrain vertices for the scene to upload
+  session.getTerrain().setVertexOutput(true);
+  session.setLogEvents(true);
+  session.setDeterministic(!recordPath.empty());
+  ControlsLog controlsLog;
+  int gameIndex = 0;
+
   bool continueGame = true;
   std::random_device rd;
 
   while (continueGame && !glfwWindowShouldClose(window))
   {
     // Generate a new random seed for terrain generation each game
-    unsigned int terrainSeed = rd();
+    unsigned int terrainSeed = fixedSeed ? firstSeed + gameIndex : rd();
+    gameIndex++;
     std::cout << "Generated terrain seed: " << terrainSeed << std::endl;
 
-    // Initialize/reinitialize scene with new seed
-    scene.init(SCR_WIDTH, SCR_HEIGHT, terrainSeed);
-
-    int score = 0;
-    float distanceTraveled = 0.0f; // Track total distance for difficulty
-    glm::vec3 startPosition = glm::vec3(0.0f);
-    // Reset game state
+    // Initialize/reinitialize scene resources
+    scene.init(SCR_WIDTH, SCR_HEIGHT);
     gameOver = false;
-    score = 0;
-    car.position = glm::vec3(0.0f);
-    car.yaw = -90.0f;
-    car.pitch = 0.0f;
-    car.roll = 0.0f;
-    car.velocity = 0.0f;
-    car.fuel = 100.0f;
-    car.turbo = 0.0f;
-
-    // Initialize display angles to match physics angles
-    car.displayYaw = car.yaw;
-    car.displayPitch = car.pitch;
-    car.displayRoll = car.roll;
 
     int selectedIndex = 0;
     // Enable cursor for menu interaction
@@ -128,34 +137,26 @@ int main()
       break;
     }
 
-    // Initialize Bullet Physics World
-    PhysicsWorld physicsWorld;
-
-    // Initialize car with physics
-    Physics::initializeCar(car, physicsWorld, car.position);
+    // Terrain, physics world, car and collectibles for this game
+    if (!session.start(terrainSeed))
+    {
+      break;
+    }
+    Car &car = session.getCar();
 
     Model coinModel(FileSystem::getPath("resources/objects/coin/Coin.obj"));
     Model fuelModel(FileSystem::getPath("resources/objects/fuel/fuel.obj"));
     Model nitroModel(FileSystem::getPath("resources/objects/nitro/nitro.obj"));
 
-    collectibles = Collectibles(); // Reset collectibles
-    collectibles.setModel(CollectibleType::COIN, &coinModel);
-    collectibles.setModel(CollectibleType::COIN_RARE, &coinModel);
-    collectibles.setModel(CollectibleType::FUEL, &fuelModel);
-    collectibles.setModel(CollectibleType::TURBO, &nitroModel);
-
-    collectibles.init();
-    // initial spawn: place coins ahead of the car along its current forward direction
-    glm::vec3 initialForward = glm::vec3(std::cos(glm::radians(car.yaw)), 0.0f, std::sin(glm::radians(car.yaw)));
-    // initial spawn: fewer coins spread further ahead
-    collectibles.spawnAlongDirection(6, car.position, initialForward, &scene.getTerrain(), CollectibleType::COIN, 8.0f, 25.0f, 1.8f);
-
-    // Spawn control variables
-    glm::vec3 lastSpawnPos = car.position;
-    const float spawnMoveThreshold = 6.0f; // only spawn if player moved this far
-    const int maxSpawnBatch = 6;           // max coins to spawn at once
-    float lastSpawnTime = 0.0f;
-    const float spawnCooldown = 1.0f; // seconds between spawn batches
+    CollectibleRenderer collectibleRenderer;
+    collectibleRenderer.setModel(CollectibleType::COIN, &coinModel);
+    collectibleRenderer.setModel(CollectibleType::COIN_RARE, &coinModel);
+    collectibleRenderer.setModel(CollectibleType::FUEL, &fuelModel);
+    collectibleRenderer.setModel(CollectibleType::TURBO, &nitroModel);
+
+    // Fixed-rate simulation; the car is drawn interpolated between the last two ticks
+    Physics::FixedTimestep timestep(120.0f);
+    controlsLog.begin(terrainSeed, 1.0f / timestep.getTickSeconds());
 
     // Main game loop: use chosen model
     while (!glfwWindowShouldClose(window) && !gameOver)
@@ -167,143 +168,61 @@ int main()
       Input::handleEscape(window);
       Input::poll(window, controls);
 
-      // Only allow boost if turbo is available
-      if (controls.boost && !car.hasTurbo())
+      // Slow frames run several ticks and fast frames may run none, so the cost and behaviour
+      // of the simulation no longer depend on the frame rate
+      int ticks = timestep.advance(deltaTime);
+      for (int i = 0; i < ticks && !session.isGameOver(); ++i)
       {
-        controls.boost = false;
+        controlsLog.record(controls);
+        session.tick(timestep.getTickSeconds(), controls);
       }
-
-      Physics::updateCar(car, deltaTime, controls, physicsWorld, &scene.getTerrain());
-      Physics::updateCamera(car, camera);
-
-      // Update distance traveled (horizontal distance from start)
-      glm::vec3 horizontalDelta = car.position - startPosition;
-      horizontalDelta.y = 0.0f; // Only count horizontal distance
-      distanceTraveled = glm::length(horizontalDelta);
-
-      // Progressive difficulty: terrain gets steeper over distance
-      // Difficulty increases by 0.1 every 100 meters, capped at 2.5x
-      float terrainDifficulty = 1.0f + (distanceTraveled / 100.0f) * 0.1f;
-      terrainDifficulty = std::min(terrainDifficulty, 2.5f);
-      scene.getTerrain().setDifficultyMultiplier(terrainDifficulty);
+      car.interpolate(timestep.alpha());
+      Scene::updateCamera(car, camera);
+      gameOver = session.isGameOver();
 
       glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-      scene.renderScene(ourShader, camera, car, selectedIndex, SCR_WIDTH, SCR_HEIGHT);
-
-      glm::vec3 forwardDir = glm::vec3(std::cos(glm::radians(car.yaw)), 0.0f, std::sin(glm::radians(car.yaw)));
-      // Update collectible collection
-      std::vector<CollectibleItem> collected;
-      int newly = collectibles.updateCollect(car.position, 1.0f, forwardDir, car.velocity, collected);
-      if (newly > 0)
-      {
-        score += newly;
-        std::cout << "Collected " << collected.size() << " items. Remaining: " << collectibles.remaining() << "  Total Score: " << score << std::endl;
-        // Handle different item types
-        for (const auto &item : collected)
-        {
-          switch (item.type)
-          {
-          case CollectibleType::COIN:
-          case CollectibleType::COIN_RARE:
-            // Already added to score
-            break;
-          case CollectibleType::TURBO:
-            car.addTurbo(static_cast<float>(item.value));
-            std::cout << "  Turbo collected! +" << item.value << "% (Now: " << car.getTurboPercent() << "%)" << std::endl;
-            break;
-          case CollectibleType::FUEL:
-            car.addFuel(item.value);
-            std::cout << "  Fuel refilled! +" << item.value << "% (Now: " << car.getFuelPercent() << "%)" << std::endl;
-            break;
-          }
-        }
-      }
-
-      // Update turbo usage (depletes when boost is active)
-      if (controls.boost && car.hasTurbo())
-      {
-        car.useTurbo(deltaTime);
-      }
-
-      // Update fuel depletion
-      bool isMoving = (controls.throttle || controls.brake || controls.steer != 0);
-      car.updateFuel(deltaTime, isMoving);
+      scene.renderScene(ourShader, camera, car, session.getTerrain(), selectedIndex, SCR_WIDTH, SCR_HEIGHT);
 
       // Update display angles for smooth visual interpolation
       car.updateDisplayAngles(deltaTime);
 
-      // Check for game over conditions
-      if (car.isOutOfFuel())
-      {
-        gameOver = true;
-      }
-
-      // Controlled respawn: spawn coins as the player moves forward in their facing direction
-      if (!gameOver)
-      {
-        float now = static_cast<float>(glfwGetTime());
-
-        // Progressive difficulty: spawn less frequently and fewer items over distance
-        // Cooldown increases from 1.0s to 3.0s over 500m
-        float progressiveCooldown = 1.0f + (distanceTraveled / 500.0f) * 2.0f;
-        progressiveCooldown = std::min(progressiveCooldown, 3.0f);
-
-        // Spawn count decreases from 6 to 2 over 500m
-        int progressiveSpawnCount = static_cast<int>(6 - (distanceTraveled / 500.0f) * 4.0f);
-        progressiveSpawnCount = std::max(progressiveSpawnCount, 2);
-
-        // compute how much the player moved forward along their facing direction since last spawn
-        glm::vec3 delta = car.position - lastSpawnPos;
-        glm::vec3 deltaXZ = glm::vec3(delta.x, 0.0f, delta.z);
-        float forwardMoved = glm::dot(glm::normalize(glm::vec3(forwardDir.x, 0.0f, forwardDir.z)), glm::normalize(glm::length(deltaXZ) > 0.0001f ? deltaXZ : glm::vec3(0.0f))) * glm::length(deltaXZ);
-        const float spawnForwardThreshold = 4.0f; // spawn when we've moved this far forward
-
-        // Only spawn when moving forward and respecting progressive cooldown
-        if (forwardMoved > spawnForwardThreshold && (now - lastSpawnTime) > progressiveCooldown)
-        {
-          // Check whether there are already coins in the forward sector; if so, don't spawn more
-          const float checkMinF = 4.0f;
-          const float checkMaxF = 20.0f;
-          const float checkLat = 2.5f;
-          if (!collectibles.hasItemsInDirection(car.position, forwardDir, checkMinF, checkMaxF, checkLat, 1, CollectibleType::COIN))
-          {
-            const float spawnMinF = 8.0f;
-            const float spawnMaxF = 30.0f;
-            const float spawnLat = 1.8f;
-
-            collectibles.spawnMixedGroup(progressiveSpawnCount, car.position, forwardDir, &scene.getTerrain(),
-                                         spawnMinF, spawnMaxF, spawnLat, 20, 20, 20);
-
-            lastSpawnPos = car.position;
-            lastSpawnTime = now;
-          }
-        }
-      }
-
-      collectibles.draw(ourShader, 0);
+      collectibleRenderer.draw(session.getCollectibles(), ourShader, 0, &scene.getFrustum());
 
       // Render UI (fuel bar, turbo bar, score, and speedometer)
       // Max speed is 40.0f (with boost) from physics.cpp
-      gameUI.render(car.getFuelPercent(), car.getTurboPercent(), score, car.velocity, 40.0f);
+      gameUI.render(car.getFuelPercent(), car.getTurboPercent(), session.getScore(), car.velocity, 40.0f);
 
       glfwSwapBuffers(window);
       glfwPollEvents();
     }
 
+    if (!recordPath.empty())
+    {
+      ControlsLog::Result result;
+      result.ticks = controlsLog.getTickCount();
+      result.score = session.getScore();
+      result.x = car.position.x;
+      result.y = car.position.y;
+      result.z = car.position.z;
+      controlsLog.setResult(result);
+      if (controlsLog.save(recordPath))
+        std::cout << "Recorded " << result.ticks << " ticks in " << controlsLog.getRuns().size() << " runs to " << recordPath << std::endl;
+    }
+
     // Game loop ended - check if game over
     if (gameOver)
     {
       std::cout << "\n========== GAME OVER ==========" << std::endl;
-      std::cout << "Out of fuel! Final Score: " << score << std::endl;
+      std::cout << "Out of fuel! Final Score: " << session.getScore() << std::endl;
       std::cout << "Click 'Continue' to return to car selection or 'Exit' to quit" << std::endl;
       std::cout << "==============================\n"
                 << std::endl;
 
       // Show game over screen with interactive buttons
       glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-      bool continueToMenu = scene.showGameOver(window, ourShader, gameUI, score, SCR_WIDTH, SCR_HEIGHT);
+      bool continueToMenu = scene.showGameOver(window, ourShader, gameUI, session.getScore(), SCR_WIDTH, SCR_HEIGHT);
       glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
       if (!continueToMenu)
@@ -1,5 +1,8 @@
 #include "PhysicsWorld.h"
+#include "../scene/Terrain.h"
 #include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+#include <cassert>
 
 btDiscreteDynamicsWorld *PhysicsWorld::getDynamicsWorld()
 {
@@ -26,18 +29,42 @@ PhysicsWorld::PhysicsWorld()
 
 PhysicsWorld::~PhysicsWorld()
 {
-  // Cleanup is handled by unique_ptr destructors
+  // Bodies must leave the world before it is destroyed; the rest is handled by unique_ptr destructors
+  reset();
+}
+
+void PhysicsWorld::reset()
+{
+  for (size_t i = 0; i < carBodiesInUse; ++i)
+    dynamicsWorld->removeRigidBody(carBodies[i].body.get());
+  carBodiesInUse = 0;
+  clearTerrain();
+  syncedTerrain = nullptr;
+  terrainRevision = 0;
+
+  // With no proxies left the broadphase drops its trees and restarts proxy ids, and the
+  // solver restarts its random sequence, so the next round steps exactly as in a new world
+  overlappingPairCache->resetPool(dispatcher.get());
+  solver->reset();
 }
 
 void PhysicsWorld::stepSimulation(float deltaTime)
 {
-  dynamicsWorld->stepSimulation(deltaTime, 10);
+  // One internal step of the same length: no substeps and no motion state interpolation,
+  // which the fixed tick loop already provides
+  dynamicsWorld->stepSimulation(deltaTime, 1, deltaTime);
 }
 
 btRigidBody *PhysicsWorld::createCarRigidBody(const btVector3 &position, float mass)
 {
-  // Create a box collision shape for the car
-  btCollisionShape *carShape = new btBoxShape(btVector3(1.0f, 0.5f, 2.0f));
+  if (carBodiesInUse == carBodies.size())
+  {
+    // Create a box collision shape for the car
+    carBodies.emplace_back();
+    carBodies.back().shape = std::make_unique<btBoxShape>(btVector3(1.0f, 0.5f, 2.0f));
+    carBodies.back().motionState = std::make_unique<btDefaultMotionState>();
+  }
+  CarBody &car = carBodies[carBodiesInUse++];
 
   btTransform carTransform;
   carTransform.setIdentity();
@@ -46,11 +73,11 @@ btRigidBody *PhysicsWorld::createCarRigidBody(const btVector3 &position, float m
   btVector3 localInertia(0, 0, 0);
   if (mass != 0.0f)
   {
-    carShape->calculateLocalInertia(mass, localInertia);
+    car.shape->calculateLocalInertia(mass, localInertia);
   }
 
-  btDefaultMotionState *motionState = new btDefaultMotionState(carTransform);
-  btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, motionState, carShape, localInertia);
+  *car.motionState = btDefaultMotionState(carTransform);
+  btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, car.motionState.get(), car.shape.get(), localInertia);
 
   // Adjust physics properties for car-like behavior
   rbInfo.m_friction = 0.8f;
@@ -58,14 +85,86 @@ btRigidBody *PhysicsWorld::createCarRigidBody(const btVector3 &position, float m
   rbInfo.m_linearDamping = 0.3f;
   rbInfo.m_angularDamping = 0.5f;
 
-  btRigidBody *body = new btRigidBody(rbInfo);
+  if (!car.body)
+  {
+    car.body = std::make_unique<btRigidBody>(rbInfo);
+  }
+  else
+  {
+    // reset() took the body out of the world, which destroyed its broadphase proxy and
+    // contact pairs. Put back everything else a new body would start with.
+    assert(!car.body->getBroadphaseHandle());
+    btRigidBody &body = *car.body;
+    body.setMassProps(mass, localInertia);
+    body.updateInertiaTensor();
+    body.setFriction(rbInfo.m_friction);
+    body.setRestitution(rbInfo.m_restitution);
+    body.setDamping(rbInfo.m_linearDamping, rbInfo.m_angularDamping);
+    body.setWorldTransform(carTransform);
+    body.setInterpolationWorldTransform(carTransform);
+    body.setLinearVelocity(btVector3(0, 0, 0));
+    body.setAngularVelocity(btVector3(0, 0, 0));
+    body.setInterpolationLinearVelocity(btVector3(0, 0, 0));
+    body.setInterpolationAngularVelocity(btVector3(0, 0, 0));
+    body.clearForces();
+    body.setDeactivationTime(0);
+    body.setHitFraction(1);
+  }
 
-  // Prevent rotation on X and Z axes (only allow Y-axis rotation for steering)
-  body->setAngularFactor(btVector3(0, 1, 0));
+  // Raycast wheels carry the body, so it pitches and rolls freely on its suspension
+  car.body->setActivationState(DISABLE_DEACTIVATION);
 
-  dynamicsWorld->addRigidBody(body);
+  dynamicsWorld->addRigidBody(car.body.get());
 
-  return body;
+  return car.body.get();
+}
+
+void PhysicsWorld::saveBody(const btRigidBody *body, BodyState &out)
+{
+  const btTransform &trans = body->getCenterOfMassTransform();
+  const btVector3 &origin = trans.getOrigin();
+  const btQuaternion rotation = trans.getRotation();
+  const btVector3 &linear = body->getLinearVelocity();
+  const btVector3 &angular = body->getAngularVelocity();
+  const btVector3 &force = body->getTotalForce();
+  const btVector3 &torque = body->getTotalTorque();
+  for (int i = 0; i < 3; ++i)
+  {
+    out.origin[i] = origin[i];
+    out.linearVelocity[i] = linear[i];
+    out.angularVelocity[i] = angular[i];
+    out.force[i] = force[i];
+    out.torque[i] = torque[i];
+  }
+  out.rotation[0] = rotation.x();
+  out.rotation[1] = rotation.y();
+  out.rotation[2] = rotation.z();
+  out.rotation[3] = rotation.w();
+}
+
+void PhysicsWorld::restoreBody(btRigidBody *body, const BodyState &state)
+{
+  btTransform trans(btQuaternion(state.rotation[0], state.rotation[1], state.rotation[2], state.rotation[3]),
+                    btVector3(state.origin[0], state.origin[1], state.origin[2]));
+  body->setWorldTransform(trans);
+  body->setInterpolationWorldTransform(trans);
+  body->getMotionState()->setWorldTransform(trans);
+
+  btVector3 linear(state.linearVelocity[0], state.linearVelocity[1], state.linearVelocity[2]);
+  btVector3 angular(state.angularVelocity[0], state.angularVelocity[1], state.angularVelocity[2]);
+  body->setLinearVelocity(linear);
+  body->setAngularVelocity(angular);
+  body->setInterpolationLinearVelocity(linear);
+  body->setInterpolationAngularVelocity(angular);
+
+  // The car's linear and angular factors are 1, so the totals go back in unscaled
+  body->clearForces();
+  body->applyCentralForce(btVector3(state.force[0], state.force[1], state.force[2]));
+  body->applyTorque(btVector3(state.torque[0], state.torque[1], state.torque[2]));
+
+  dynamicsWorld->updateSingleAabb(body);
+  if (body->getBroadphaseHandle())
+    overlappingPairCache->getOverlappingPairCache()->cleanProxyFromPairs(body->getBroadphaseHandle(), dispatcher.get());
 }
 
 btRigidBody *PhysicsWorld::createTerrainBody(btTriangleMesh *terrainMesh)
@@ -89,3 +188,67 @@ btRigidBody *PhysicsWorld::createTerrainBody(btTriangleMesh *terrainMesh)
 
   return body;
 }
+
+void PhysicsWorld::clearTerrain()
+{
+  for (int i = 0; i < terrainBodyCount; ++i)
+    dynamicsWorld->removeRigidBody(terrainBodies[i].body.get());
+  terrainBodyCount = 0;
+}
+
+void PhysicsWorld::syncTerrain(const Terrain &terrain)
+{
+  if (syncedTerrain == &terrain && terrainRevision == terrain.getRevision())
+    return;
+  syncedTerrain = &terrain;
+  terrainRevision = terrain.getRevision();
+
+  clearTerrain();
+
+  Terrain::HeightSegment segments[MAX_TERRAIN_BODIES];
+  int count = terrain.getHeightSegments(segments);
+  if (count == 0)
+    return;
+
+  float minY = 0.0f;
+  float maxY = 0.0f;
+  terrain.getHeightRange(minY, maxY);
+  const float scale = terrain.getScale();
+
+  for (int i = 0; i < count; ++i)
+  {
+    const Terrain::HeightSegment &seg = segments[i];
+    TerrainBody &tb = terrainBodies[i];
+
+    // Same diagonal as the render mesh and height queries (flipQuadEdges), so collision matches
+    // the interpolated surface of the grid it was built from
+    auto shape = std::make_unique<btHeightfieldTerrainShape>(seg.width, seg.rows, seg.data, 1.0f, minY, maxY, 1, PHY_FLOAT, true);
+    shape->setLocalScaling(btVector3(scale, 1.0f, scale));
+
+    // A heightfield is centered on its bounding box
+    btTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(btVector3(seg.originX + (seg.width - 1) * 0.5f * scale,
+                                  (minY + maxY) * 0.5f,
+                                  seg.originZ + (seg.rows - 1) * 0.5f * scale));
+
+    if (!tb.body)
+    {
+      tb.motionState = std::make_unique<btDefaultMotionState>(transform);
+      btRigidBody::btRigidBodyConstructionInfo rbInfo(0.0f, tb.motionState.get(), shape.get(), btVector3(0, 0, 0));
+      rbInfo.m_friction = 1.0f;
+      rbInfo.m_restitution = 0.0f;
+      tb.body = std::make_unique<btRigidBody>(rbInfo);
+    }
+    else
+    {
+      tb.body->setCollisionShape(shape.get());
+      tb.motionState->setWorldTransform(transform);
+      tb.body->setWorldTransform(transform);
+    }
+    tb.shape = std::move(shape);
+
+    dynamicsWorld->addRigidBody(tb.body.get());
+  }
+  terrainBodyCount = count;
+}
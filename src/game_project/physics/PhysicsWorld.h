@@ -2,6 +2,7 @@
 #define GAME_PROJECT_PHYSICS_WORLD_H
 
 #include <memory>
+#include <vector>
 
 // Forward declarations to avoid header conflicts between Bullet and Assimp
 class btDefaultCollisionConfiguration;
@@ -12,28 +13,91 @@ class btDiscreteDynamicsWorld;
 class btRigidBody;
 class btVector3;
 class btTriangleMesh;
+class btHeightfieldTerrainShape;
+class btDefaultMotionState;
+class btBoxShape;
+class Terrain;
 
 class PhysicsWorld
 {
 public:
+  // Motion of one rigid body at the end of a tick, in plain floats so snapshots need no
+  // Bullet headers
+  struct BodyState
+  {
+    float origin[3];
+    float rotation[4]; // quaternion x, y, z, w
+    float linearVelocity[3];
+    float angularVelocity[3];
+    // Forces applied after the step (e.g. lift), which the next step still has to use
+    float force[3];
+    float torque[3];
+  };
+
   PhysicsWorld();
   ~PhysicsWorld();
 
+  // Advance the world by exactly one step of deltaTime (callers run it at a fixed tick rate)
   void stepSimulation(float deltaTime);
   btDiscreteDynamicsWorld *getDynamicsWorld();
 
-  // Helper to create a rigid body for the car
+  // Remove every body and step like a new world again, without new Bullet allocations: the
+  // broadphase, dispatcher and solver are kept, and car bodies return to a pool that
+  // createCarRigidBody() reuses
+  void reset();
+
+  // Helper to create a rigid body for the car. The world owns it (shape and motion state
+  // included). After reset() it is out of the world, and a later call hands the same body
+  // out again in its new starting state.
   btRigidBody *createCarRigidBody(const btVector3 &position, float mass);
 
+  static void saveBody(const btRigidBody *body, BodyState &out);
+  // Put a body of this world back in a saved state. Its contact points are dropped, so the
+  // next step starts them afresh rather than from the ones found at the later tick.
+  void restoreBody(btRigidBody *body, const BodyState &state);
+
   // Helper to create a static terrain collision shape
   btRigidBody *createTerrainBody(btTriangleMesh *terrainMesh);
 
+  // Keep static heightfield collision in step with the terrain window. The heightfields read
+  // the terrain's height rows in place; when the window changes only the (cheap) shapes are
+  // re-pointed, nothing is copied or rebuilt. Does nothing if the terrain revision is unchanged.
+  void syncTerrain(const Terrain &terrain);
+  // True while heightfield collision is in the world
+  bool hasTerrainCollision() const { return terrainBodyCount > 0; }
+
 private:
+  void clearTerrain();
+
+  // The ring-buffered terrain is at most two contiguous runs of rows, one heightfield each
+  static constexpr int MAX_TERRAIN_BODIES = 2;
+  struct TerrainBody
+  {
+    std::unique_ptr<btHeightfieldTerrainShape> shape;
+    std::unique_ptr<btDefaultMotionState> motionState;
+    std::unique_ptr<btRigidBody> body;
+  };
+
   std::unique_ptr<btDefaultCollisionConfiguration> collisionConfiguration;
   std::unique_ptr<btCollisionDispatcher> dispatcher;
   std::unique_ptr<btBroadphaseInterface> overlappingPairCache;
   std::unique_ptr<btSequentialImpulseConstraintSolver> solver;
   std::unique_ptr<btDiscreteDynamicsWorld> dynamicsWorld;
+
+  struct CarBody
+  {
+    std::unique_ptr<btBoxShape> shape;
+    std::unique_ptr<btDefaultMotionState> motionState;
+    std::unique_ptr<btRigidBody> body;
+  };
+  // Every car body ever created; the first carBodiesInUse are in the world
+  std::vector<CarBody> carBodies;
+  size_t carBodiesInUse = 0;
+
+  TerrainBody terrainBodies[MAX_TERRAIN_BODIES];
+  int terrainBodyCount = 0;
+  const Terrain *syncedTerrain = nullptr;
+  unsigned int terrainRevision = 0;
 };
 
 #endif
@@ -4,6 +4,7 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
+#include <algorithm>
 
 namespace
 {
@@ -17,7 +18,30 @@ namespace
     constexpr float CAR_MASS = 750.0f;
     constexpr float MAX_REVERSE = 6.0f;
     constexpr float BOOST_FORCE_MULTIPLIER = 2.5f;
+
+    // Raycast wheels
+    constexpr float WHEEL_BASE = 2.0f;                // distance between front and rear axles
+    constexpr float TRACK_WIDTH = 1.5f;               // distance between left and right wheels
+    constexpr float WHEEL_RADIUS = 0.4f;
+    constexpr float SUSPENSION_REST = 0.3f;           // spring length with no load
+    constexpr float SUSPENSION_STIFFNESS = 30000.0f;  // N/m; about 6 cm of sag under the car's weight
+    constexpr float SUSPENSION_DAMPING = 2500.0f;     // N s/m; about half of critical damping
+    constexpr float TIRE_GRIP = 1.2f;                 // sideways force limit as a multiple of the wheel load
+  }
+}
+
+int Physics::FixedTimestep::advance(float frameSeconds)
+{
+  accumulator += std::max(frameSeconds, 0.0f);
+  int ticks = static_cast<int>(accumulator / tickSeconds);
+  if (ticks > maxTicks)
+  {
+    ticks = maxTicks;
+    accumulator = 0.0f;
+    return ticks;
   }
+  accumulator -= ticks * tickSeconds;
+  return ticks;
 }
 
 void Physics::initializeCar(Car &car, PhysicsWorld &world, const glm::vec3 &startPos)
@@ -35,8 +59,10 @@ void Physics::initializeCar(Car &car, PhysicsWorld &world, const glm::vec3 &star
   car.rigidBody->getMotionState()->setWorldTransform(trans);
   car.rigidBody->setWorldTransform(trans);
 
-  // Initial sync
+  // Initial sync; there is no earlier tick to interpolate from
   car.syncFromPhysics();
+  car.beginTick();
+  car.interpolate(1.0f);
 }
 
 void Physics::updateCar(Car &car, float dt, const Controls &c, PhysicsWorld &world, Terrain *terrain)
@@ -94,6 +120,15 @@ void Physics::updateCar(Car &car, float dt, const Controls &c, PhysicsWorld &wor
     car.rigidBody->applyTorque(torque);
   }
 
+  // Terrain collision reads the current terrain window; re-point it if the window moved.
+  // The wheels push the body off the ground before the step.
+  if (terrain != nullptr)
+  {
+    world.syncTerrain(*terrain);
+    Car *cars[1] = {&car};
+    applyWheelForces(cars, 1, dt, *terrain);
+  }
+
   // Step the physics simulation
   world.stepSimulation(dt);
 
@@ -105,42 +140,23 @@ void Physics::updateCar(Car &car, float dt, const Controls &c, PhysicsWorld &wor
   const float FLIGHT_SPEED_THRESHOLD = 20.0f; // Speed required to take off
   const float LIFT_FORCE = 3500.0f;           // Upward force when flying at high speed
   const float TAKEOFF_BOOST = 2000.0f;        // Extra upward force to initiate takeoff
-  const float AIR_DISTANCE = 1.0f;            // Distance above terrain to consider "airborne"
 
-  // Four-wheel terrain contact system with realistic physics
   if (terrain != nullptr)
   {
-    // Car dimensions (adjust these based on your car model size)
-    const float WHEEL_BASE = 2.0f;   // Distance between front and rear axles
-    const float TRACK_WIDTH = 1.5f;  // Distance between left and right wheels
-    const float WHEEL_RADIUS = 0.4f; // Wheel size
-
-    // Get car's current orientation
-    float yawRad = glm::radians(car.yaw);
-    glm::vec3 forward(cos(yawRad), 0.0f, sin(yawRad));
-    glm::vec3 right(-forward.z, 0.0f, forward.x);
-
-    // Calculate wheel positions in world space
-    glm::vec3 frontLeft = car.position + forward * (WHEEL_BASE * 0.5f) + right * (TRACK_WIDTH * 0.5f);
-    glm::vec3 frontRight = car.position + forward * (WHEEL_BASE * 0.5f) - right * (TRACK_WIDTH * 0.5f);
-    glm::vec3 rearLeft = car.position - forward * (WHEEL_BASE * 0.5f) + right * (TRACK_WIDTH * 0.5f);
-    glm::vec3 rearRight = car.position - forward * (WHEEL_BASE * 0.5f) - right * (TRACK_WIDTH * 0.5f);
-
-    // Get terrain height at each wheel position
-    float heightFL = terrain->getHeight(frontLeft.x, frontLeft.z);
-    float heightFR = terrain->getHeight(frontRight.x, frontRight.z);
-    float heightRL = terrain->getHeight(rearLeft.x, rearLeft.z);
-    float heightRR = terrain->getHeight(rearRight.x, rearRight.z);
-
-    // Calculate average terrain height
-    float avgTerrainHeight = (heightFL + heightFR + heightRL + heightRR) * 0.25f;
-    float distanceAboveTerrain = car.position.y - avgTerrainHeight;
-
-    // Check if car should be flying
-    bool isAirborne = distanceAboveTerrain > AIR_DISTANCE;
-    bool wantsToFly = currentSpeed > FLIGHT_SPEED_THRESHOLD;
+    bool isAirborne = car.wheelsInContact == 0;
+
+    // A hard landing leaves a crater: the car was falling fast and this step stopped it
+    const float HARD_LANDING_SPEED = 8.0f;
+    float fallSpeed = -velocity.y();
+    if (fallSpeed > HARD_LANDING_SPEED && !isAirborne &&
+        car.rigidBody->getLinearVelocity().y() > -0.5f * fallSpeed)
+    {
+      float impact = fallSpeed / HARD_LANDING_SPEED;
+      terrain->deform(car.position.x, car.position.z, std::min(2.5f * impact, 6.0f), std::min(0.25f * impact, 1.0f));
+    }
 
     // Apply lift force when going fast enough (both grounded and airborne)
+    bool wantsToFly = currentSpeed > FLIGHT_SPEED_THRESHOLD;
     if (wantsToFly)
     {
       float speedRatio = (currentSpeed - FLIGHT_SPEED_THRESHOLD) / FLIGHT_SPEED_THRESHOLD;
@@ -157,96 +173,87 @@ void Physics::updateCar(Car &car, float dt, const Controls &c, PhysicsWorld &wor
         car.rigidBody->applyCentralForce(takeoffForce);
       }
     }
+  }
+}
 
-    // Ground alignment only when not flying fast
-    if (!wantsToFly || distanceAboveTerrain < 0.2f)
+void Physics::applyWheelForces(Car *const *cars, int count, float dt, const Terrain &terrain)
+{
+  // Hardpoints in body space: the car faces local -X, so the wheelbase runs along X and the
+  // track along Z. Rays point down the body's -Y axis.
+  const btVector3 HARDPOINTS[4] = {
+      btVector3(-CFG::WHEEL_BASE * 0.5f, 0.0f, CFG::TRACK_WIDTH * 0.5f),
+      btVector3(-CFG::WHEEL_BASE * 0.5f, 0.0f, -CFG::TRACK_WIDTH * 0.5f),
+      btVector3(CFG::WHEEL_BASE * 0.5f, 0.0f, CFG::TRACK_WIDTH * 0.5f),
+      btVector3(CFG::WHEEL_BASE * 0.5f, 0.0f, -CFG::TRACK_WIDTH * 0.5f)};
+  const float RAY_LENGTH = CFG::SUSPENSION_REST + CFG::WHEEL_RADIUS;
+
+  // Cars are processed in groups whose wheels fit one batched terrain query on the stack
+  const int CARS_PER_BATCH = 16;
+  const int BATCH = CARS_PER_BATCH * 4;
+  float wheelX[BATCH];
+  float wheelZ[BATCH];
+  float groundY[BATCH];
+  glm::vec3 groundNormal[BATCH];
+  btVector3 hardpoint[BATCH];
+
+  for (int first = 0; first < count; first += CARS_PER_BATCH)
+  {
+    const int n = std::min(CARS_PER_BATCH, count - first);
+    for (int c = 0; c < n; ++c)
     {
-      // Ground mode - snap to terrain and align with surface
-      // Calculate average height and pitch/roll from wheel heights
-      float avgFront = (heightFL + heightFR) * 0.5f;
-      float avgRear = (heightRL + heightRR) * 0.5f;
-      float avgLeft = (heightFL + heightRL) * 0.5f;
-      float avgRight = (heightFR + heightRR) * 0.5f;
-
-      // Calculate pitch (front-rear tilt) and roll (left-right tilt)
-      float targetPitch = -std::atan2(avgFront - avgRear, WHEEL_BASE);
-      float targetRoll = std::atan2(avgLeft - avgRight, TRACK_WIDTH);
-
-      // Get current orientation for smooth interpolation
-      float currentPitch = glm::radians(car.pitch);
-      float currentRoll = glm::radians(car.roll);
-
-      // Smooth interpolation factor
-      const float TERRAIN_ALIGN_SPEED = 6.0f;
-      float lerpFactor = glm::clamp(TERRAIN_ALIGN_SPEED * dt, 0.0f, 1.0f);
-
-      // Interpolate to target orientation
-      float smoothPitch = currentPitch + (targetPitch - currentPitch) * lerpFactor;
-      float smoothRoll = currentRoll + (targetRoll - currentRoll) * lerpFactor;
-
-      // Average of all four wheels for car center height
-      float targetHeight = avgTerrainHeight + WHEEL_RADIUS;
-
-      // Only snap if car is below or close to terrain
-      if (car.position.y <= targetHeight + 0.5f)
+      const btTransform &trans = cars[first + c]->rigidBody->getCenterOfMassTransform();
+      for (int w = 0; w < 4; ++w)
       {
-        // Update car physics transform with new position and orientation
-        btTransform newTrans;
-        car.rigidBody->getMotionState()->getWorldTransform(newTrans);
-
-        // Set new position
-        newTrans.setOrigin(btVector3(car.position.x, targetHeight, car.position.z));
-
-        // Create rotation quaternion from yaw, pitch, roll (using smoothed values)
-        btQuaternion rotation;
-        rotation.setEulerZYX(smoothRoll, glm::radians(car.yaw), smoothPitch);
-        newTrans.setRotation(rotation);
-
-        // Apply the transform
-        car.rigidBody->setWorldTransform(newTrans);
-        car.rigidBody->getMotionState()->setWorldTransform(newTrans);
-
-        // Reset vertical velocity when landing
-        btVector3 vel = car.rigidBody->getLinearVelocity();
-        vel.setY(0);
-        car.rigidBody->setLinearVelocity(vel);
+        hardpoint[c * 4 + w] = trans * HARDPOINTS[w];
+        wheelX[c * 4 + w] = hardpoint[c * 4 + w].x();
+        wheelZ[c * 4 + w] = hardpoint[c * 4 + w].z();
+      }
+    }
+    terrain.sampleHeightsAndNormals(wheelX, wheelZ, n * 4, groundY, groundNormal);
 
-        // Sync back to car
-        car.syncFromPhysics();
+    for (int c = 0; c < n; ++c)
+    {
+      Car &car = *cars[first + c];
+      btRigidBody *body = car.rigidBody;
+      const btTransform &trans = body->getCenterOfMassTransform();
+      const btVector3 up = trans.getBasis().getColumn(1);
+      const btVector3 side = trans.getBasis().getColumn(2);
+      const float wheelMass = body->getInvMass() > 0.0f ? 0.25f / body->getInvMass() : 0.0f;
+
+      car.wheelsInContact = 0;
+      for (int w = 0; w < 4; ++w)
+      {
+        const int i = c * 4 + w;
+        const btVector3 normal(groundNormal[i].x, groundNormal[i].y, groundNormal[i].z);
+
+        // Distance along the ray to the ground plane through the sampled point under the hardpoint
+        const float along = up.dot(normal);
+        if (along < 0.1f)
+          continue;
+        const float t = (hardpoint[i].y() - groundY[i]) * normal.y() / along;
+        if (t > RAY_LENGTH)
+          continue;
+        car.wheelsInContact++;
+
+        // Spring and damper along the suspension axis; the chassis collision takes over once
+        // the spring is fully compressed
+        const float compression = std::min(RAY_LENGTH - t, CFG::SUSPENSION_REST);
+        const btVector3 relPos = hardpoint[i] - trans.getOrigin();
+        const btVector3 pointVelocity = body->getVelocityInLocalPoint(relPos);
+        float load = CFG::SUSPENSION_STIFFNESS * compression - CFG::SUSPENSION_DAMPING * pointVelocity.dot(up);
+        load = std::max(load, 0.0f);
+        body->applyForce(up * load, relPos);
+
+        // Tire grip: cancel sideways slip over the tick, up to grip * load
+        btVector3 lateral = side - normal * side.dot(normal);
+        if (lateral.length2() < 1e-6f)
+          continue;
+        lateral.normalize();
+        float grip = -pointVelocity.dot(lateral) * wheelMass / dt;
+        const float maxGrip = CFG::TIRE_GRIP * load;
+        grip = std::max(-maxGrip, std::min(grip, maxGrip));
+        body->applyForce(lateral * grip, relPos);
       }
     }
   }
 }
-
-void Physics::updateCamera(const Car &car, Camera &cam)
-{
-  // Position camera to the right side of the car, slightly behind, and above
-  const float SIDE_DIST = 15.0f;  // how far to the right of the car
-  const float BACK_OFFSET = 1.0f; // small offset behind the car
-  const float HEIGHT = 7.5f;      // camera height above car position
-  const float PITCH_DEG = -20.0f; // desired camera pitch in degrees
-
-  float yawRad = glm::radians(car.yaw);
-  glm::vec3 forwardVec = glm::vec3(cos(yawRad), 0.0f, sin(yawRad));
-  // right vector from forward and world-up
-  glm::vec3 rightVec = glm::vec3(-forwardVec.z, 0.0f, forwardVec.x);
-
-  glm::vec3 desiredCamPos = car.position + rightVec * SIDE_DIST - forwardVec * BACK_OFFSET + glm::vec3(0.0f, HEIGHT, 0.0f);
-  cam.Position = desiredCamPos;
-
-  // Compute horizontal yaw to look roughly toward the car, but enforce the requested pitch
-  float lookX = car.position.x - cam.Position.x;
-  float lookZ = car.position.z - cam.Position.z;
-  float yawDeg = glm::degrees(std::atan2(lookZ, lookX));
-  cam.Yaw = yawDeg;
-  cam.Pitch = PITCH_DEG;
-
-  // Recompute Front/Right/Up using the camera's Euler angles (same math as Camera::updateCameraVectors)
-  glm::vec3 front;
-  front.x = cos(glm::radians(cam.Yaw)) * cos(glm::radians(cam.Pitch));
-  front.y = sin(glm::radians(cam.Pitch));
-  front.z = sin(glm::radians(cam.Yaw)) * cos(glm::radians(cam.Pitch));
-  cam.Front = glm::normalize(front);
-  cam.Right = glm::normalize(glm::cross(cam.Front, cam.WorldUp));
-  cam.Up = glm::normalize(glm::cross(cam.Right, cam.Front));
-}
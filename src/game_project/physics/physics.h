@@ -4,16 +4,42 @@
 #include "../core/car.h"
 #include "../core/controls.h"
 #include "PhysicsWorld.h"
-#include <learnopengl/camera.h>
 
 // forward-declare Terrain to avoid circular includes
 class Terrain;
 
 namespace Physics
 {
+  // Splits frame time into fixed-length simulation ticks. Time short of a whole tick carries
+  // over to the next frame, and alpha() says how far the frame is between the last two ticks.
+  class FixedTimestep
+  {
+  public:
+    explicit FixedTimestep(float tickRate = 120.0f, int maxTicksPerFrame = 8)
+        : tickSeconds(1.0f / tickRate), maxTicks(maxTicksPerFrame) {}
+
+    void setTickRate(float tickRate) { tickSeconds = 1.0f / tickRate; }
+    float getTickSeconds() const { return tickSeconds; }
+
+    // Add one frame's time and return how many ticks to run now. Time beyond maxTicksPerFrame
+    // ticks is dropped, so a long stall slows the game down briefly instead of making the
+    // next frames even slower.
+    int advance(float frameSeconds);
+    float alpha() const { return accumulator / tickSeconds; }
+
+  private:
+    float tickSeconds;
+    int maxTicks;
+    float accumulator = 0.0f;
+  };
+
   void initializeCar(Car &car, PhysicsWorld &world, const glm::vec3 &startPos);
+  // Advance the car and the physics world by one tick of dt seconds
   void updateCar(Car &car, float dt, const Controls &c, PhysicsWorld &world, Terrain *terrain = nullptr);
-  void updateCamera(const Car &car, Camera &cam);
+  // Cast the four wheel rays of each car at the terrain, all cars in one batched height query,
+  // and apply suspension and tire forces to their bodies. Sets Car::wheelsInContact. Call once
+  // per tick before stepping the world; updateCar does this for its car.
+  void applyWheelForces(Car *const *cars, int count, float dt, const Terrain &terrain);
 }
 
 #endif
@@ -0,0 +1,87 @@
+#include "CollectibleRenderer.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+void CollectibleRenderer::setModel(CollectibleType type, Model *m)
+{
+  models[type] = m;
+  if (m && modelBounds.find(m) == modelBounds.end())
+    modelBounds.emplace(m, generateAABB(*m));
+}
+
+void CollectibleRenderer::draw(const Collectibles &collectibles, Shader &shader, unsigned int fallbackTexture, const Frustum *frustum)
+{
+  lastVisible = 0;
+  lastDrawable = 0;
+  float t = static_cast<float>(glfwGetTime());
+
+  for (const CollectibleItem &item : collectibles.getItems())
+  {
+    if (item.collected)
+      continue;
+    ++lastDrawable;
+
+    glm::mat4 m(1.0f);
+
+    float bounce = sinf(t * item.bobFrequency + item.bobPhase) * item.bobAmplitude;
+    float bounceAbs = fabsf(bounce);
+    float scale = Collectibles::getScale(item.type);
+    m = glm::translate(m, item.position + glm::vec3(0.0f, Collectibles::getBaseLift(item.type) + bounceAbs, 0.0f));
+
+    float spin = t * 180.0f;
+    m = glm::rotate(m, glm::radians(spin), glm::vec3(0.0f, 1.0f, 0.0f));
+    m = glm::scale(m, glm::vec3(scale));
+
+    // Use specific model for this item type, or fallback to COIN model.
+    // Rare coins use the same model as regular coins (just different color)
+    CollectibleType typeForModel = item.type == CollectibleType::COIN_RARE ? CollectibleType::COIN : item.type;
+    Model *modelToUse = nullptr;
+    auto it = models.find(typeForModel);
+    if (it == models.end())
+      it = models.find(CollectibleType::COIN);
+    if (it != models.end())
+      modelToUse = it->second;
+
+    // Skip items outside the camera frustum before touching any GL state
+    if (frustum && modelToUse)
+    {
+      auto boundsIt = modelBounds.find(modelToUse);
+      if (boundsIt != modelBounds.end())
+      {
+        Transform transform;
+        transform.computeModelMatrix(m);
+        if (!boundsIt->second.isOnFrustum(*frustum, transform))
+          continue;
+      }
+    }
+    ++lastVisible;
+
+    shader.setMat4("model", m);
+
+    // Coins use a plain texture with a color override; fuel and turbo models use their embedded materials
+    if (item.type == CollectibleType::COIN || item.type == CollectibleType::COIN_RARE)
+    {
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, fallbackTexture);
+      shader.setInt("texture_diffuse1", 0);
+      shader.setBool("useColor", true);
+      shader.setVec3("objectColor", item.color);
+    }
+    else
+    {
+      shader.setBool("useColor", false);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    if (modelToUse)
+      modelToUse->Draw(shader);
+
+    // Reset state after drawing
+    shader.setBool("useColor", false);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  glBindVertexArray(0);
+}
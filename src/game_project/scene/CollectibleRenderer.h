@@ -0,0 +1,27 @@
+#pragma once
+
+#include <map>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/model.h>
+#include <learnopengl/entity.h>
+
+#include "../core/collectible.h"
+
+// Draws the items of a Collectibles set with one model per type. Collectibles itself only
+// holds game state, so it can run without GL.
+class CollectibleRenderer
+{
+public:
+  void setModel(CollectibleType type, Model *m);
+  // Items outside frustum (when given) are skipped; see visibleCount()/drawableCount()
+  void draw(const Collectibles &collectibles, Shader &shader, unsigned int fallbackTexture, const Frustum *frustum = nullptr);
+  // Items drawn and uncollected items considered by the last draw()
+  int visibleCount() const { return lastVisible; }
+  int drawableCount() const { return lastDrawable; }
+
+private:
+  std::map<CollectibleType, Model *> models;
+  std::map<const Model *, AABB> modelBounds; // model space bounds, computed in setModel
+  int lastVisible = 0;
+  int lastDrawable = 0;
+};
@@ -1,7 +1,7 @@
 #include "Terrain.h"
 #include <glm/gtc/constants.hpp>
-#include <glm/gtc/type_ptr.hpp>
 #include <cmath>
+#include <chrono>
 #include <iostream>
 #include <algorithm>
 #include <cstddef>
@@ -9,352 +9,625 @@
 Terrain::Terrain() {}
 Terrain::~Terrain() { cleanup(); }
 
-void Terrain::smoothHeights(int iterations)
+bool Terrain::init(int w, int d, float s, float hscale, unsigned int seed)
 {
-  if (width < 2 || depth < 2)
-    return;
+  stopWorker();
 
-  std::vector<float> smoothed = heights;
+  // Whole chunks only, so chunk boundaries line up with the ring buffer's row shifts
+  w = std::max((w - 1 + CHUNK_SIZE - 1) / CHUNK_SIZE, 1) * CHUNK_SIZE + 1;
+  d = std::max((d + CHUNK_SIZE - 1) / CHUNK_SIZE, 2) * CHUNK_SIZE;
 
-  for (int iter = 0; iter < iterations; ++iter)
+  // Build the new window beside the published one, which snapshots may still be reading
+  TerrainWindow *window = findFreeWindow();
+  if (!window)
   {
-    for (int iz = 1; iz < depth - 1; ++iz)
-    {
-      for (int ix = 1; ix < width - 1; ++ix)
-      {
-        // Apply 3x3 box blur
-        float sum = 0.0f;
-        int count = 0;
-
-        for (int dz = -1; dz <= 1; ++dz)
-        {
-          for (int dx = -1; dx <= 1; ++dx)
-          {
-            sum += heights[(iz + dz) * width + (ix + dx)];
-            count++;
-          }
-        }
-
-        smoothed[iz * width + ix] = sum / count;
-      }
-    }
-    heights = smoothed;
+    std::cerr << "Terrain::init: every height window is held by a snapshot" << std::endl;
+    return false;
   }
+  window->grid.setRepresentation(representation);
+  window->grid.setLateralDetail(lateralDetail);
+  window->grid.setDifficultyMultiplier(difficultyMultiplier);
+  window->grid.init(w, d, s, hscale, seed);
+  if (corridorSubdivisions > 0)
+  {
+    // Same noise sampled finer; the smoothing radius grows with it so both grids blur over the
+    // same world distance and agree where they overlap
+    const int k = corridorSubdivisions;
+    const float spacing = s / k;
+    const int cw = 2 * std::max(static_cast<int>(std::round(corridorHalfWidth / spacing)), 1) + 1;
+    const int cd = 2 * std::max(static_cast<int>(std::round(corridorHalfLength / spacing)), 1);
+    window->corridor.setRepresentation(TerrainGrid::Representation::Grid);
+    window->corridor.setSmoothRadius((k * (2 * TerrainGrid::SMOOTH_RADIUS + 1) - 1) / 2);
+    window->corridor.setLateralDetail(lateralDetail);
+    window->corridor.setDifficultyMultiplier(difficultyMultiplier);
+    window->corridor.init(cw, cd, spacing, hscale, seed);
+  }
+  else
+  {
+    window->corridor.clear();
+  }
+  front = window;
+  current.store(window);
+  lastPlayerZ = 0.0f;
+  stats.workerLead = 0.0f;
+  stats.jobsCompleted = 0;
+  stats.lastJobMs = 0.0f;
+  stats.rowsGenerated = 0;
+  stats.lateRows = 0;
+  stats.windowStalls = 0;
+  stats.editsApplied = 0;
+  stats.verticesPatched = 0;
+  pendingEdits.clear();
+
+  updateChunkBounds(front->grid, {{0, d}}, chunkHeights);
+  revision++;
+  buildVertices = vertexOutput;
+  pendingVertices.runs.clear();
+  pendingVertices.vertices.clear();
+  if (buildVertices)
+    stageAllVertices();
+
+  startWorker();
+  return true;
 }
 
-static float sampleNoise(float x, float z, unsigned int seed)
+void Terrain::cleanup()
 {
-  // Use seed to create unique phase offsets and select equation pattern
-  float seedOffset1 = (seed % 1000) * 0.01f;
-  float seedOffset2 = ((seed / 1000) % 1000) * 0.01f;
-  float seedOffset3 = ((seed / 1000000) % 1000) * 0.01f;
-  float seedOffset4 = ((seed / 1000000000) % 1000) * 0.01f;
-
-  // Select terrain pattern based on seed
-  int pattern = seed % 8;
-
-  float v = 0.0f;
-
-  switch (pattern)
-  {
-  case 0: // Classic rolling hills
-    v += 1.0f * std::sin(z * 0.05f + seedOffset1);
-    v += 0.5f * std::sin(z * 0.12f + seedOffset2);
-    v += 0.25f * std::sin(z * 0.23f + seedOffset3);
-    v += 0.125f * std::sin(z * 0.41f + seedOffset4);
-    break;
-
-  case 1: // Sharp ridges
-    v += 1.2f * std::sin(z * 0.08f + seedOffset2);
-    v += 0.6f * std::cos(z * 0.15f + seedOffset4);
-    v += 0.3f * std::sin(z * 0.25f + seedOffset1);
-    v += 0.15f * std::cos(z * 0.35f + seedOffset2);
-    break;
-
-  case 2: // Wavy dunes
-    v += 1.0f * std::sin(z * 0.06f + seedOffset1);
-    v += 0.8f * std::cos(z * 0.04f + seedOffset2);
-    v += 0.4f * std::sin(z * 0.1f + seedOffset3);
-    v += 0.2f * std::cos(z * 0.12f + seedOffset4);
-    break;
-
-  case 3: // Gentle waves
-    v += 1.0f * std::sin(z * 0.07f + seedOffset1);
-    v += 0.5f * std::sin(z * 0.15f + seedOffset3);
-    v += 0.25f * std::sin(z * 0.18f + seedOffset2);
-    break;
-
-  case 4: // Steep hills
-  {
-    v += 1.0f * std::sin(z * 0.05f + seedOffset1);
-    v += 0.5f * std::cos(z * 0.1f + seedOffset2);
-    v += 0.3f * std::sin(z * 0.2f + seedOffset3);
-    v += 0.2f * std::cos(z * 0.3f + seedOffset1);
-    break;
-  }
+  stopWorker();
 
-  case 5: // Complex fractal-like
-    v += 1.0f * std::sin(z * 0.04f + seedOffset1);
-    v += 0.6f * std::cos(z * 0.09f + seedOffset4);
-    v += 0.35f * std::sin(z * 0.19f + seedOffset2);
-    v += 0.2f * std::cos(z * 0.33f + seedOffset4);
-    v += 0.1f * std::sin(z * 0.48f + seedOffset2);
-    break;
-
-  case 6: // Turbulent mix
-    v += 1.1f * (std::sin(z * 0.06f + seedOffset1) + std::cos(z * 0.05f + seedOffset2)) * 0.5f;
-    v += 0.55f * (std::sin(z * 0.13f + seedOffset3) + std::sin(z * 0.11f + seedOffset4)) * 0.5f;
-    v += 0.3f * std::sin(z * 0.18f + seedOffset1);
-    v += 0.15f * std::cos(z * 0.31f + seedOffset4);
-    break;
-
-  case 7: // Mountain peaks
-    v += 1.3f * std::sin(z * 0.04f + seedOffset2);
-    v += 0.7f * std::sin(z * 0.07f + seedOffset4);
-    v += 0.4f * std::cos(z * 0.14f + seedOffset2);
-    v += 0.2f * std::cos(z * 0.27f + seedOffset4);
-    v += 0.1f * std::sin(z * 0.35f + seedOffset1);
-    break;
+  // Free the spare windows; the published one stays readable until the next init()
+  for (TerrainWindow &window : windows)
+  {
+    if (&window != front && window.readers.load() == 0)
+    {
+      window.grid.clear();
+      window.corridor.clear();
+    }
   }
-
-  return v;
+  back = nullptr;
+  stagedVertices.clear();
+  stagedRuns.clear();
+  pendingVertices.runs.clear();
+  pendingVertices.vertices.clear();
+  chunkHeights.clear();
+  stagedChunkHeights.clear();
 }
 
-bool Terrain::init(int w, int d, float s, float hscale, unsigned int seed)
+void Terrain::startWorker()
 {
-  width = w;
-  depth = d;
-  scale = s;
-  heightScale = hscale;
-  terrainSeed = seed;
-
-  heights.assign(width * depth, 0.0f);
+  workerQuit = false;
+  jobState = JobState::Idle;
+  if (asyncGeneration)
+    worker = std::thread(&Terrain::workerLoop, this);
+}
 
-  for (int iz = 0; iz < depth; ++iz)
+void Terrain::stopWorker()
+{
+  if (worker.joinable())
   {
-    for (int ix = 0; ix < width; ++ix)
     {
-      float wx = (ix - width / 2) * scale;
-      float wz = (iz - depth / 2) * scale;
-      float h = sampleNoise(wx, wz, terrainSeed) * heightScale * difficultyMultiplier;
-      heights[iz * width + ix] = h;
+      std::lock_guard<std::mutex> lock(jobMutex);
+      workerQuit = true;
     }
+    jobCv.notify_all();
+    worker.join();
   }
-
-  // Apply smoothing to make terrain transitions more gradual
-  smoothHeights(2);
-
-  return generateMesh();
+  jobState = JobState::Idle;
+  back = nullptr;
 }
 
-void Terrain::cleanup()
+void Terrain::workerLoop()
 {
-  if (EBO)
+  std::unique_lock<std::mutex> lock(jobMutex);
+  while (true)
   {
-    glDeleteBuffers(1, &EBO);
-    EBO = 0;
+    jobCv.wait(lock, [this]
+               { return workerQuit || jobState == JobState::Queued; });
+    if (workerQuit)
+      return;
+
+    // The job only touches 'back' and the staging buffers, which the main thread
+    // leaves alone until the state flips to Done
+    lock.unlock();
+    runJob();
+    lock.lock();
+    jobState = JobState::Done;
   }
-  if (VBO)
+}
+
+TerrainWindow *Terrain::findFreeWindow()
+{
+  // A reader that picked up a window before it was retired increments its count, then sees
+  // that it is no longer current and lets go without reading it, so a count of zero here
+  // means the window can be rewritten
+  for (TerrainWindow &window : windows)
   {
-    glDeleteBuffers(1, &VBO);
-    VBO = 0;
+    if (&window != front && window.readers.load() == 0)
+      return &window;
   }
-  if (VAO)
+  return nullptr;
+}
+
+TerrainSnapshot Terrain::acquireSnapshot() const
+{
+  while (true)
   {
-    glDeleteVertexArrays(1, &VAO);
-    VAO = 0;
+    TerrainWindow *window = current.load();
+    window->readers.fetch_add(1);
+    // Only fails if a new window was published in between; retry with that one
+    if (current.load() == window)
+      return TerrainSnapshot(window);
+    window->readers.fetch_sub(1);
   }
-  indexCount = 0;
-  heights.clear();
 }
 
-bool Terrain::generateMesh()
+bool Terrain::submitJob(const GridMove &gridMove, const GridMove &corridorMove)
 {
-  if (width < 2 || depth < 2)
+  back = findFreeWindow();
+  if (!back)
+  {
+    stats.windowStalls++;
     return false;
+  }
 
-  struct Vertex
+  jobGrid = gridMove;
+  jobCorridor = corridorMove;
+  jobEdits.swap(pendingEdits);
+  pendingEdits.clear();
+  jobDifficulty = difficultyMultiplier;
+
+  if (!worker.joinable())
   {
-    float px, py, pz;
-    float nx, ny, nz;
-    float u, v;
-  };
-  std::vector<Vertex> verts;
-  verts.reserve(width * depth);
+    runJob();
+    jobState = JobState::Done;
+    publishJob();
+    return true;
+  }
 
-  // helper to compute normal via central differences
-  auto computeNormalAt = [&](int ix, int iz) -> glm::vec3
   {
-    auto h = [&](int x, int z) -> float
-    {
-      x = std::clamp(x, 0, width - 1);
-      z = std::clamp(z, 0, depth - 1);
-      return heights[z * width + x];
-    };
-    float dx = h(ix + 1, iz) - h(ix - 1, iz);
-    float dz = h(ix, iz + 1) - h(ix, iz - 1);
-    glm::vec3 n = glm::normalize(glm::vec3(-dx, 2.0f, -dz));
-    return n;
-  };
+    std::lock_guard<std::mutex> lock(jobMutex);
+    jobState = JobState::Queued;
+  }
+  jobCv.notify_one();
+  return true;
+}
 
-  for (int iz = 0; iz < depth; ++iz)
+void Terrain::applyMove(TerrainGrid &grid, const GridMove &move, TerrainGrid::RowRanges &dirtyRows)
+{
+  if (move.fullRebuild)
+  {
+    grid.moveTo(move.offsetX, move.shiftRows);
+    dirtyRows.push_back({0, grid.getDepth()});
+  }
+  else
   {
-    for (int ix = 0; ix < width; ++ix)
+    grid.streamRows(move.shiftRows, dirtyRows);
+  }
+}
+
+void Terrain::runJob()
+{
+  auto start = std::chrono::steady_clock::now();
+
+  // Bring the back window up to date with the published one, then advance it
+  back->grid = front->grid;
+  back->grid.setDifficultyMultiplier(jobDifficulty);
+  back->corridor = front->corridor;
+  back->corridor.setDifficultyMultiplier(jobDifficulty);
+
+  // The corridor has no mesh, so its changed rows need no further work
+  TerrainGrid::RowRanges corridorRows;
+  if (jobCorridor.active)
+    applyMove(back->corridor, jobCorridor, corridorRows);
+  TerrainGrid::RowRanges dirtyRows;
+  if (jobGrid.active)
+    applyMove(back->grid, jobGrid, dirtyRows);
+
+  // Edits land on the moved window; only the rectangles they change are rebuilt
+  std::vector<TerrainGrid::CellRect> patches;
+  for (const TerrainGrid::Edit &edit : jobEdits)
+  {
+    TerrainGrid::CellRect rect;
+    back->corridor.deform(edit, rect);
+    if (back->grid.deform(edit, rect))
+      patches.push_back(rect);
+  }
+
+  // Build vertices for the changed rows, grouped into runs of contiguous physical rows.
+  // Without a renderer only the chunk bounds below are kept up to date.
+  const int width = back->grid.getWidth();
+  const int depth = back->grid.getDepth();
+  stagedVertices.clear();
+  stagedRuns.clear();
+  if (buildVertices)
+  {
+    for (const auto &range : dirtyRows)
     {
-      float wx = (ix - width / 2) * scale + offsetX;
-      float wz = (iz - depth / 2) * scale + offsetZ;
-      float h = heights[iz * width + ix];
-      glm::vec3 n = computeNormalAt(ix, iz);
-      Vertex v;
-      v.px = wx;
-      v.py = h;
-      v.pz = wz;
-      v.nx = n.x;
-      v.ny = n.y;
-      v.nz = n.z;
-      v.u = (float)ix / (float)(width - 1);
-      v.v = (float)iz / (float)(depth - 1);
-      verts.push_back(v);
+      int iz = range.first;
+      while (iz < range.second)
+      {
+        int row = back->grid.physicalRow(iz);
+        int run = std::min(range.second - iz, depth - row);
+        size_t base = stagedVertices.size();
+        stagedVertices.resize(base + run * width);
+        for (int r = 0; r < run; ++r)
+          back->grid.buildRowVertices(iz + r, &stagedVertices[base + r * width]);
+        stagedRuns.push_back({row, run, 0, width});
+        iz += run;
+      }
     }
   }
 
-  std::vector<unsigned int> indices;
-  indices.reserve((width - 1) * (depth - 1) * 6);
-  for (int iz = 0; iz < depth - 1; ++iz)
+  // Patches re-upload only their columns, one row at a time
+  std::vector<TerrainVertex> rowVertices(buildVertices ? width : 0);
+  jobEditsApplied = static_cast<int>(patches.size());
+  jobVerticesPatched = 0;
+  for (const TerrainGrid::CellRect &rect : patches)
   {
-    for (int ix = 0; ix < width - 1; ++ix)
+    const int cols = rect.lastCol - rect.firstCol;
+    if (buildVertices)
     {
-      unsigned int a = iz * width + ix;
-      unsigned int b = iz * width + (ix + 1);
-      unsigned int c = (iz + 1) * width + (ix + 1);
-      unsigned int d = (iz + 1) * width + ix;
-      // two triangles: a,b,c and a,c,d
-      indices.push_back(a);
-      indices.push_back(b);
-      indices.push_back(c);
-      indices.push_back(a);
-      indices.push_back(c);
-      indices.push_back(d);
+      for (int iz = rect.firstRow; iz < rect.lastRow; ++iz)
+      {
+        back->grid.buildRowVertices(iz, rowVertices.data());
+        stagedVertices.insert(stagedVertices.end(), rowVertices.begin() + rect.firstCol, rowVertices.begin() + rect.lastCol);
+        stagedRuns.push_back({back->grid.physicalRow(iz), 1, rect.firstCol, cols});
+      }
+      jobVerticesPatched += (rect.lastRow - rect.firstRow) * cols;
     }
+    dirtyRows.push_back({rect.firstRow, rect.lastRow});
   }
 
-  // upload to GPU
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-  glGenBuffers(1, &EBO);
+  stagedChunkHeights = chunkHeights;
+  updateChunkBounds(back->grid, dirtyRows, stagedChunkHeights);
 
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(Vertex), verts.data(), GL_STATIC_DRAW);
+  auto end = std::chrono::steady_clock::now();
+  jobElapsedMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+void Terrain::publishJob()
+{
+  const int depth = back->grid.getDepth();
+
+  // Rows the new window covers that the old one did not, and how many of them the player
+  // could already see
+  const int oldFirst = front->grid.getRowOrigin();
+  const int newFirst = back->grid.getRowOrigin();
+  for (int g = newFirst; g < newFirst + depth; ++g)
+  {
+    if (g >= oldFirst && g < oldFirst + depth)
+      continue;
+    stats.rowsGenerated++;
+    float wz = (g - newFirst - depth / 2) * back->grid.getScale() + back->grid.getOffsetZ();
+    if (std::abs(wz - lastPlayerZ) <= lastViewDistance)
+      stats.lateRows++;
+  }
+
+  // Readers that already hold the old window keep it; new snapshots get this one
+  front = back;
+  back = nullptr;
+  current.store(front);
+
+  // Hand the staged vertices on; a renderer uploads them on its own thread
+  if (buildVertices)
+  {
+    pendingVertices.vertices.insert(pendingVertices.vertices.end(), stagedVertices.begin(), stagedVertices.end());
+    pendingVertices.runs.insert(pendingVertices.runs.end(), stagedRuns.begin(), stagedRuns.end());
+  }
 
-  // position
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, px));
-  glEnableVertexAttribArray(0);
-  // normal
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, nx));
-  glEnableVertexAttribArray(1);
-  // texcoord
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, u));
-  glEnableVertexAttribArray(2);
+  std::swap(chunkHeights, stagedChunkHeights);
+  // Every published window has its own storage, so the height segments always move, even
+  // when the physics grid's contents did not change
+  revision++;
+  stats.editsApplied += jobEditsApplied;
+  stats.verticesPatched += jobVerticesPatched;
 
-  glBindVertexArray(0);
+  stats.jobsCompleted++;
+  stats.lastJobMs = jobElapsedMs;
+  jobState = JobState::Idle;
+}
 
-  indexCount = static_cast<GLsizei>(indices.size());
+bool Terrain::takeVertexUpdate(VertexUpdate &out)
+{
+  if (pendingVertices.runs.empty())
+    return false;
+  // Swap so both sides keep their capacity
+  std::swap(out, pendingVertices);
+  pendingVertices.reset = false;
+  pendingVertices.width = out.width;
+  pendingVertices.depth = out.depth;
+  pendingVertices.vertices.clear();
+  pendingVertices.runs.clear();
   return true;
 }
 
+void Terrain::stageAllVertices()
+{
+  const int width = front->grid.getWidth();
+  const int depth = front->grid.getDepth();
+
+  // Vertices are laid out in physical (ring) order plus the mirrored row 0 at the end
+  std::vector<TerrainVertex> &verts = pendingVertices.vertices;
+  verts.resize(width * (depth + 1));
+  for (int iz = 0; iz < depth; ++iz)
+    front->grid.buildRowVertices(iz, &verts[front->grid.physicalRow(iz) * width]);
+  std::copy(verts.begin(), verts.begin() + width, verts.begin() + depth * width);
+
+  pendingVertices.reset = true;
+  pendingVertices.width = width;
+  pendingVertices.depth = depth;
+  pendingVertices.runs.push_back({0, depth + 1, 0, width});
+}
+
+void Terrain::updateChunkBounds(const TerrainGrid &grid, const TerrainGrid::RowRanges &rows, std::vector<glm::vec2> &bounds)
+{
+  const int chunksX = (grid.getWidth() - 1) / CHUNK_SIZE;
+  const int chunkRows = grid.getDepth() / CHUNK_SIZE;
+  bounds.resize(chunksX * chunkRows);
+  for (const auto &range : rows)
+  {
+    // Chunk row cz spans logical rows [cz * CHUNK_SIZE, (cz + 1) * CHUNK_SIZE]
+    int czFirst = std::max(range.first - 1, 0) / CHUNK_SIZE;
+    int czLast = std::min((range.second - 1) / CHUNK_SIZE, chunkRows - 1);
+    for (int cz = czFirst; cz <= czLast; ++cz)
+    {
+      const int row = cz * CHUNK_SIZE;
+      glm::vec2 *out = &bounds[grid.physicalRow(row) / CHUNK_SIZE * chunksX];
+      for (int cx = 0; cx < chunksX; ++cx)
+        grid.getHeightRange(cx * CHUNK_SIZE, (cx + 1) * CHUNK_SIZE + 1, row, row + CHUNK_SIZE + 1, out[cx].x, out[cx].y);
+    }
+  }
+}
+
+namespace
+{
+  // The grid that answers a query at (x,z)
+  const TerrainGrid &queryGrid(const TerrainSnapshot &snapshot, float x, float z)
+  {
+    return snapshot.corridor().contains(x, z) ? snapshot.corridor() : snapshot.grid();
+  }
+}
+
 float Terrain::getHeight(float x, float z) const
 {
-  if (width < 2 || depth < 2)
-    return 0.0f;
-  // Adjust for terrain offset
-  float fx = ((x - offsetX) / scale) + (width / 2.0f);
-  float fz = ((z - offsetZ) / scale) + (depth / 2.0f);
-  int ix = static_cast<int>(std::floor(fx));
-  int iz = static_cast<int>(std::floor(fz));
-  float tx = fx - ix;
-  float tz = fz - iz;
-  auto h = [&](int xidx, int zidx) -> float
-  {
-    xidx = std::clamp(xidx, 0, width - 1);
-    zidx = std::clamp(zidx, 0, depth - 1);
-    return heights[zidx * width + xidx];
+  TerrainSnapshot snapshot = acquireSnapshot();
+  return queryGrid(snapshot, x, z).getHeight(x, z);
+}
+
+int Terrain::getHeightSegments(HeightSegment out[2]) const
+{
+  const TerrainGrid &grid = physicsGrid();
+  const int width = grid.getWidth();
+  const int depth = grid.getDepth();
+  const int ringStart = grid.getRingStart();
+  if (depth < 2 || !grid.rowData(0))
+    return 0;
+
+  const float scale = grid.getScale();
+  const float originX = (0 - width / 2) * scale + grid.getOffsetX();
+  auto segment = [&](int physicalRow, int logicalRow, int rows)
+  {
+    HeightSegment seg;
+    seg.data = grid.rowData(physicalRow);
+    seg.width = width;
+    seg.rows = rows;
+    seg.originX = originX;
+    seg.originZ = (logicalRow - depth / 2) * scale + grid.getOffsetZ();
+    return seg;
   };
-  float h00 = h(ix, iz);
-  float h10 = h(ix + 1, iz);
-  float h01 = h(ix, iz + 1);
-  float h11 = h(ix + 1, iz + 1);
-  float hx0 = h00 * (1 - tx) + h10 * tx;
-  float hx1 = h01 * (1 - tx) + h11 * tx;
-  float hval = hx0 * (1 - tz) + hx1 * tz;
-  return hval;
+
+  // Logical rows [0, depth - ringStart] are physical rows [ringStart, depth], ending on the
+  // mirrored row 0; the rest of the window is physical rows [0, ringStart)
+  if (ringStart == 0)
+  {
+    out[0] = segment(0, 0, depth);
+    return 1;
+  }
+  out[0] = segment(ringStart, 0, depth - ringStart + 1);
+  if (ringStart < 2)
+    return 1;
+  out[1] = segment(0, depth - ringStart, ringStart);
+  return 2;
+}
+
+void Terrain::getHeightRange(float &minY, float &maxY) const
+{
+  minY = 0.0f;
+  maxY = 0.0f;
+  if (hasCorridor())
+  {
+    front->corridor.getHeightBounds(minY, maxY);
+    return;
+  }
+  if (chunkHeights.empty())
+    return;
+  minY = chunkHeights[0].x;
+  maxY = chunkHeights[0].y;
+  for (const auto &h : chunkHeights)
+  {
+    minY = std::min(minY, h.x);
+    maxY = std::max(maxY, h.y);
+  }
+}
+
+glm::vec2 Terrain::getSlope(float x, float z) const
+{
+  TerrainSnapshot snapshot = acquireSnapshot();
+  return queryGrid(snapshot, x, z).getSlope(x, z);
 }
 
 glm::vec3 Terrain::getNormal(float x, float z) const
 {
-  const float EPS = 0.1f;
-  float hL = getHeight(x - EPS, z);
-  float hR = getHeight(x + EPS, z);
-  float hD = getHeight(x, z - EPS);
-  float hU = getHeight(x, z + EPS);
-  glm::vec3 n = glm::normalize(glm::vec3(hL - hR, 2.0f * EPS, hD - hU));
-  return n;
+  glm::vec2 s = getSlope(x, z);
+  return glm::normalize(glm::vec3(-s.x, 1.0f, -s.y));
 }
 
-void Terrain::update(float playerX, float playerZ)
+void Terrain::sampleHeights(const float *x, const float *z, int count, float *outHeight) const
 {
-  // Regenerate terrain when player moves far from current center
-  const float REGEN_DISTANCE = (width * scale) * 0.3f; // Regenerate when 30% away from center
+  sampleSnapshot(acquireSnapshot(), x, z, count, outHeight, nullptr, nullptr);
+}
 
-  float distX = playerX - offsetX;
-  float distZ = playerZ - offsetZ;
+void Terrain::sampleHeightsAndGradients(const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz) const
+{
+  sampleSnapshot(acquireSnapshot(), x, z, count, outHeight, outDx, outDz);
+}
 
-  bool needsRegeneration = false;
+void Terrain::sampleSnapshot(const TerrainSnapshot &snapshot, const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz)
+{
+  const TerrainGrid &corridor = snapshot.corridor();
+  if (corridor.getDepth() == 0)
+  {
+    if (outDx)
+      snapshot.grid().sampleHeightsAndGradients(x, z, count, outHeight, outDx, outDz);
+    else
+      snapshot.grid().sampleHeights(x, z, count, outHeight);
+    return;
+  }
 
-  // Check if player has moved far enough in X direction
-  if (std::abs(distX) > REGEN_DISTANCE)
+  // Physics queries stay near the player, so batch them through the corridor and redo the
+  // few that fall outside it on the render grid
+  if (outDx)
+    corridor.sampleHeightsAndGradients(x, z, count, outHeight, outDx, outDz);
+  else
+    corridor.sampleHeights(x, z, count, outHeight);
+  for (int i = 0; i < count; ++i)
   {
-    offsetX += (distX > 0 ? 1.0f : -1.0f) * REGEN_DISTANCE;
-    needsRegeneration = true;
+    if (corridor.contains(x[i], z[i]))
+      continue;
+    if (outDx)
+      snapshot.grid().sampleHeightsAndGradients(x + i, z + i, 1, outHeight + i, outDx + i, outDz + i);
+    else
+      outHeight[i] = snapshot.grid().getHeight(x[i], z[i]);
   }
+}
 
-  // Check if player has moved far enough in Z direction
-  if (std::abs(distZ) > REGEN_DISTANCE)
+bool Terrain::raycast(const glm::vec3 &origin, const glm::vec3 &dir, float maxDist, float &outDist) const
+{
+  return acquireSnapshot().grid().raycast(origin, dir, maxDist, outDist);
+}
+
+void Terrain::sampleHeightsAndNormals(const float *x, const float *z, int count, float *outHeight, glm::vec3 *outNormal) const
+{
+  // Gradients are produced in chunks on the stack, then turned into normals
+  TerrainSnapshot snapshot = acquireSnapshot();
+  const int BATCH = 64;
+  float dx[BATCH];
+  float dz[BATCH];
+  for (int first = 0; first < count; first += BATCH)
   {
-    offsetZ += (distZ > 0 ? 1.0f : -1.0f) * REGEN_DISTANCE;
-    needsRegeneration = true;
+    int n = std::min(BATCH, count - first);
+    sampleSnapshot(snapshot, x + first, z + first, n, outHeight + first, dx, dz);
+    for (int i = 0; i < n; ++i)
+      outNormal[first + i] = glm::normalize(glm::vec3(-dx[i], 1.0f, -dz[i]));
   }
+}
 
-  if (needsRegeneration)
+void Terrain::update(float playerX, float playerZ, float velocityX, float velocityZ)
+{
+  if (front->grid.getDepth() < 2)
+    return;
+
+  if (playerZ != lastPlayerZ)
+    travelDirZ = playerZ > lastPlayerZ ? 1.0f : -1.0f;
+  lastPlayerZ = playerZ;
+
+  bool swapped = false;
+  bool idle = false;
   {
-    // Regenerate height data centered around new offset
-    for (int iz = 0; iz < depth; ++iz)
+    std::lock_guard<std::mutex> lock(jobMutex);
+    if (jobState == JobState::Done)
     {
-      for (int ix = 0; ix < width; ++ix)
-      {
-        float wx = (ix - width / 2) * scale + offsetX;
-        float wz = (iz - depth / 2) * scale + offsetZ;
-        float h = sampleNoise(wx, wz, terrainSeed) * heightScale * difficultyMultiplier;
-        heights[iz * width + ix] = h;
-      }
+      publishJob();
+      swapped = true;
     }
+    idle = jobState == JobState::Idle;
+  }
 
-    // Apply smoothing to make terrain transitions more gradual
-    smoothHeights(2);
+  // Lead of the newest finished window over the player, towards where the player is heading
+  stats.workerLead = travelDirZ < 0.0f ? playerZ - front->grid.getMinZ() : front->grid.getMaxZ() - playerZ;
+
+  // Never queue a job in the same call that swapped: callers get one update to stop
+  // using height segments of the previous window before the worker may overwrite it
+  if (swapped || !idle)
+    return;
 
-    // Rebuild the mesh with new heights
-    generateMesh();
+  const float scale = front->grid.getScale();
+  // Regenerate terrain when player moves far from current center
+  const float REGEN_DISTANCE = (front->grid.getWidth() * scale) * 0.3f; // Regenerate when 30% away from center
+  // Shift by whole chunks so chunks keep mapping to contiguous rows of the vertex buffer
+  const int REGEN_ROWS = std::max(1, static_cast<int>(std::round(REGEN_DISTANCE / scale / CHUNK_SIZE))) * CHUNK_SIZE;
+
+  // Aim the window at where the player will be after the lookahead time, keeping at least
+  // a quarter of the window behind the player on each axis
+  const float maxLeadX = (front->grid.getWidth() / 4) * scale;
+  const float maxLeadZ = (front->grid.getDepth() / 4) * scale;
+  const float leadX = std::clamp(velocityX * prefetchSeconds, -maxLeadX, maxLeadX);
+  const float leadZ = std::clamp(velocityZ * prefetchSeconds, -maxLeadZ, maxLeadZ);
+  // Rows one job may add without staging more vertex data than the budget
+  const size_t rowBytes = front->grid.getWidth() * sizeof(TerrainVertex);
+  const int budgetRows = std::max(1, static_cast<int>(prefetchBudgetBytes / rowBytes / CHUNK_SIZE)) * CHUNK_SIZE;
+
+  float distX = playerX + leadX - front->grid.getOffsetX();
+  float distZ = playerZ + leadZ - front->grid.getOffsetZ();
+
+  GridMove gridMove;
+  // Check if the target has moved far enough in Z direction; catch up with it in one job if the budget allows
+  if (std::abs(distZ) > REGEN_DISTANCE)
+  {
+    int rows = std::max(REGEN_ROWS, static_cast<int>(std::round(std::abs(distZ) / scale / CHUNK_SIZE)) * CHUNK_SIZE);
+    rows = std::min(rows, budgetRows);
+    gridMove.shiftRows = distZ > 0 ? rows : -rows;
+  }
+
+  // Check if player has moved far enough in X direction; every vertex moves, so rebuild fully
+  if (std::abs(distX) > REGEN_DISTANCE)
+  {
+    gridMove.active = true;
+    gridMove.offsetX = front->grid.getOffsetX() + (distX > 0 ? 1.0f : -1.0f) * REGEN_DISTANCE;
+    gridMove.fullRebuild = true;
+  }
+  else if (gridMove.shiftRows != 0)
+  {
+    gridMove.active = true;
+    gridMove.offsetX = front->grid.getOffsetX();
+    gridMove.fullRebuild = !streaming;
   }
+
+  // The corridor is small enough to recenter on the target in one job, and follows it closely.
+  // Across X it stays on the player: a sideways lead would rebuild it on every weave.
+  GridMove corridorMove;
+  if (hasCorridor())
+  {
+    const TerrainGrid &corridor = front->corridor;
+    const float spacing = corridor.getScale();
+    const float corridorLead = std::clamp(velocityZ * prefetchSeconds, -(corridor.getDepth() / 4) * spacing, (corridor.getDepth() / 4) * spacing);
+    const float cdx = playerX - corridor.getOffsetX();
+    const float cdz = playerZ + corridorLead - corridor.getOffsetZ();
+    corridorMove.shiftRows = static_cast<int>(std::round(cdz / spacing));
+    if (std::abs(cdx) > 0.25f * corridorHalfWidth)
+    {
+      corridorMove.active = true;
+      corridorMove.offsetX = playerX;
+      corridorMove.fullRebuild = true;
+    }
+    else if (std::abs(cdz) > 0.25f * corridorHalfLength)
+    {
+      corridorMove.active = true;
+      corridorMove.offsetX = corridor.getOffsetX();
+      corridorMove.fullRebuild = !streaming;
+    }
+  }
+
+  if (gridMove.active || corridorMove.active || !pendingEdits.empty())
+    submitJob(gridMove, corridorMove);
 }
 
-void Terrain::render()
+void Terrain::deform(float x, float z, float radius, float depth)
 {
-  if (!VAO)
-    return;
-  glBindVertexArray(VAO);
-  glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
+  TerrainGrid::Edit edit;
+  edit.x = x;
+  edit.z = z;
+  edit.radius = radius;
+  edit.depth = depth;
+  pendingEdits.push_back(edit);
 }
@@ -1,10 +1,74 @@
 #pragma once
 
 #include <vector>
-#include <glad/glad.h>
+#include <cstddef>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <glm/glm.hpp>
 
-class Shader;
+#include "TerrainGrid.h"
+
+// Runtime counters for terrain streaming
+struct TerrainStats
+{
+  float workerLead = 0.0f;  // distance from the player to the far edge of the newest window, along the travel direction
+  int jobsCompleted = 0;    // windows built by the worker and swapped in
+  float lastJobMs = 0.0f;   // worker time spent on the last window
+  int rowsGenerated = 0;    // rows newly brought into the window
+  int lateRows = 0;         // of those, rows already within the last render view distance of the player when swapped in
+  int windowStalls = 0;     // updates that could not start a job because snapshots held every spare window
+  int editsApplied = 0;     // deform() calls that changed the render window
+  int verticesPatched = 0;  // render vertices rebuilt for them
+};
+
+// One height window. Published windows are immutable; 'readers' counts the snapshots holding it.
+struct TerrainWindow
+{
+  TerrainGrid grid;
+  TerrainGrid corridor; // finer grid around the player for physics queries; empty when disabled
+  std::atomic<int> readers{0};
+};
+
+// Read-only handle on a published terrain window, safe to use from any thread. The window is
+// not reused while the snapshot is alive, so queries never block and never see a half-built grid.
+class TerrainSnapshot
+{
+public:
+  TerrainSnapshot() = default;
+  ~TerrainSnapshot() { release(); }
+  TerrainSnapshot(TerrainSnapshot &&other) noexcept : window(other.window) { other.window = nullptr; }
+  TerrainSnapshot &operator=(TerrainSnapshot &&other) noexcept
+  {
+    if (this != &other)
+    {
+      release();
+      window = other.window;
+      other.window = nullptr;
+    }
+    return *this;
+  }
+  TerrainSnapshot(const TerrainSnapshot &) = delete;
+  TerrainSnapshot &operator=(const TerrainSnapshot &) = delete;
+
+  explicit operator bool() const { return window != nullptr; }
+  const TerrainGrid &grid() const { return window->grid; }
+  const TerrainGrid &corridor() const { return window->corridor; }
+
+private:
+  friend class Terrain;
+  explicit TerrainSnapshot(TerrainWindow *w) : window(w) {}
+  void release()
+  {
+    if (window)
+      window->readers.fetch_sub(1, std::memory_order_release);
+    window = nullptr;
+  }
+
+  TerrainWindow *window = nullptr;
+};
 
 class Terrain
 {
@@ -12,43 +76,220 @@ public:
   Terrain();
   ~Terrain();
 
-  // Initialize terrain mesh. width/depth are grid counts, scale is spacing, heightScale multiplies the generated height
+  // Quads per side of a render chunk; the window streams in whole chunk rows
+  static constexpr int CHUNK_SIZE = 16;
+
+  // Initialize terrain heights. width/depth are grid counts, scale is spacing, heightScale multiplies the generated height.
+  // The grid is rounded up to whole chunks: width to a multiple of CHUNK_SIZE plus one, depth to a multiple of CHUNK_SIZE.
   bool init(int width = 128, int depth = 128, float scale = 1.0f, float heightScale = 2.5f, unsigned int seed = 0);
   void cleanup();
 
-  // Render terrain (uses currently bound shader; shader must accept 'model')
-  void render();
+  // Update terrain position for infinite generation based on player position and velocity.
+  // Swaps in a window finished by the worker, or hands the worker the next one to build.
+  // The window is centered on where the player will be after the prefetch lookahead time.
+  void update(float playerX, float playerZ, float velocityX = 0.0f, float velocityZ = 0.0f);
+
+  // Stream only newly exposed rows when moving along Z (false = regenerate the whole grid)
+  void setStreamingEnabled(bool enabled) { streaming = enabled; }
+  // Height storage (full grid or one height per row) and optional detail across rows; applied at the next init()
+  void setRepresentation(TerrainGrid::Representation r) { representation = r; }
+  void setLateralDetail(TerrainGrid::LateralDetail detail) { lateralDetail = std::move(detail); }
+  // Build new windows on a worker thread (false = build inline during update)
+  void setAsyncGeneration(bool enabled) { asyncGeneration = enabled; }
+  // Lead the window by velocity * lookaheadSeconds, in X and Z (0 = keep it centered on the
+  // player). The physics corridor leads along Z only.
+  // budgetBytes caps the vertex data one job may stage, and so how many rows it may add at once.
+  void setPrefetch(float lookaheadSeconds, size_t budgetBytes)
+  {
+    prefetchSeconds = lookaheadSeconds;
+    prefetchBudgetBytes = budgetBytes;
+  }
+
+  // Give physics queries their own grid, halfWidth x halfLength world units around the player,
+  // with spacing scale / subdivisions (rounded up to odd so its smoothing footprint matches the
+  // render grid's). Points outside it fall back to the render grid. 0 subdivisions = off.
+  // Applied at the next init().
+  void setPhysicsCorridor(float halfWidth, float halfLength, int subdivisions)
+  {
+    corridorHalfWidth = halfWidth;
+    corridorHalfLength = halfLength;
+    corridorSubdivisions = subdivisions > 0 ? subdivisions | 1 : 0;
+  }
 
-  // Update terrain position for infinite generation based on player position
-  void update(float playerX, float playerZ);
+  // Press a bowl into the terrain at (x,z): lowered by depth at the center (raised if negative),
+  // back to the original surface at radius. Applied to both grids by the next job, which
+  // resmooths and re-uploads only the vertices around it. Edits are kept, so rows that stream
+  // back in later still show them. A Profile render grid ignores them (the corridor does not).
+  void deform(float x, float z, float radius, float depth);
 
   // Set difficulty multiplier (1.0 = normal, higher = steeper terrain)
   void setDifficultyMultiplier(float multiplier) { difficultyMultiplier = multiplier; }
 
+  // The published height window, held until the snapshot is destroyed. Never blocks.
+  TerrainSnapshot acquireSnapshot() const;
+
+  // Height queries below may be called from any thread; each one reads a single snapshot.
+  // They read the physics corridor where it covers the point, else the render grid.
   // Sample terrain height at world (x,z)
   float getHeight(float x, float z) const;
-  // Estimated normal at world (x,z)
+  // Surface normal and slope (dh/dx, dh/dz) at world (x,z), read from the precomputed slope grid
   glm::vec3 getNormal(float x, float z) const;
+  glm::vec2 getSlope(float x, float z) const;
+
+  // Batched height queries over count points given as separate x and z arrays.
+  // One pass per batch; prefer these over per-point getHeight/getNormal in hot loops.
+  void sampleHeights(const float *x, const float *z, int count, float *outHeight) const;
+  // Heights plus the slope dh/dx, dh/dz at each point
+  void sampleHeightsAndGradients(const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz) const;
+  // Heights plus unit surface normals
+  void sampleHeightsAndNormals(const float *x, const float *z, int count, float *outHeight, glm::vec3 *outNormal) const;
+  // Distance along dir to the first terrain hit within maxDist (see TerrainGrid::raycast).
+  // Always traced through the render grid, which covers the whole view.
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &dir, float maxDist, float &outDist) const;
+
+  // Rows of the physics height grid (the corridor when enabled, else the render grid) that are
+  // contiguous in memory, in logical (-Z to +Z) order.
+  // Sample (i, j) of a segment is data[j * width + i], at world (originX + i * scale, originZ + j * scale).
+  struct HeightSegment
+  {
+    const float *data = nullptr;
+    int width = 0;
+    int rows = 0;
+    float originX = 0.0f;
+    float originZ = 0.0f;
+  };
+  // Fills up to two segments that together cover the window (the ring buffer wraps once) and
+  // returns how many. Returns 0 when heights are not stored as floats (Profile and Quantized).
+  // The pointers stay valid until the revision changes. This and everything below is for the
+  // thread that calls update().
+  int getHeightSegments(HeightSegment out[2]) const;
+  // Incremented whenever getHeightSegments would return different pointers or heights: at
+  // init() and at every window swap
+  unsigned int getRevision() const { return revision; }
+  // Lowest and highest height in the grid getHeightSegments covers, and its spacing
+  void getHeightRange(float &minY, float &maxY) const;
+  float getScale() const { return physicsGrid().getScale(); }
+
+  // Vertices in physical rows [row, row + rows), columns [firstCol, firstCol + cols)
+  struct VertexRun
+  {
+    int row = 0;
+    int rows = 0;
+    int firstCol = 0;
+    int cols = 0;
+  };
+  // Render vertex changes, laid out like the render grid's ring: physical rows, then row 0
+  // mirrored after the last one
+  struct VertexUpdate
+  {
+    bool reset = false; // the terrain was re-initialized; the first run is all depth + 1 rows
+    int width = 0;
+    int depth = 0;
+    std::vector<TerrainVertex> vertices;
+    std::vector<VertexRun> runs; // consecutive ranges of vertices, oldest first
+  };
+  // Build render vertices for a renderer (see TerrainMesh) to collect with takeVertexUpdate().
+  // Off by default, so a simulation without a display skips that work. Applied at the next init().
+  void setVertexOutput(bool enabled) { vertexOutput = enabled; }
+  // Moves the vertex changes published since the last call into out; false when there are none.
+  // Changes pile up until they are taken, so call this every frame once output is on.
+  bool takeVertexUpdate(VertexUpdate &out);
+
+  // The published render grid and the (min, max) height of each of its chunks, indexed by
+  // physical chunk row * chunks across
+  const TerrainGrid &getGrid() const { return front->grid; }
+  const std::vector<glm::vec2> &getChunkHeights() const { return chunkHeights; }
+  // Distance the renderer draws to; rows swapped in closer than this count as late
+  void setViewDistance(float distance) { lastViewDistance = distance; }
+
+  const TerrainStats &getStats() const { return stats; }
 
 private:
-  bool generateMesh();
-  void smoothHeights(int iterations = 2);
+  enum class JobState
+  {
+    Idle,    // no back window
+    Queued,  // job handed to the worker
+    Done     // back window and staged vertices are ready to publish
+  };
 
-  int width = 0;
-  int depth = 0;
-  float scale = 1.0f;
-  float heightScale = 1.0f;
+  // Queue every vertex of the published grid as a reset update
+  void stageAllVertices();
+  // Recompute the height range of every chunk that touches the given logical rows
+  static void updateChunkBounds(const TerrainGrid &grid, const TerrainGrid::RowRanges &rows, std::vector<glm::vec2> &bounds);
+  void startWorker();
+  void stopWorker();
+  void workerLoop();
+  // How one job moves a grid of the window
+  struct GridMove
+  {
+    bool active = false;
+    float offsetX = 0.0f;
+    int shiftRows = 0;
+    bool fullRebuild = false; // resample every row instead of streaming the new ones
+  };
+  static void applyMove(TerrainGrid &grid, const GridMove &move, TerrainGrid::RowRanges &dirtyRows);
+  // False when no spare window is free; the update is retried on the next call
+  bool submitJob(const GridMove &gridMove, const GridMove &corridorMove);
+  void runJob();
+  void publishJob();
+  // Batched heights (and gradients unless outDx is null) from one snapshot, routed per point
+  static void sampleSnapshot(const TerrainSnapshot &snapshot, const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz);
+
+  // A spare window no snapshot holds, or null
+  TerrainWindow *findFreeWindow();
+  bool hasCorridor() const { return front->corridor.getDepth() > 0; }
+  const TerrainGrid &physicsGrid() const { return hasCorridor() ? front->corridor : front->grid; }
+
+  // Height windows. 'current' is the published one that snapshots read; the worker builds the
+  // next window in a spare one, and publishing it is a single atomic store. A third window
+  // lets readers keep holding the previous one while the next is built.
+  static constexpr int WINDOW_COUNT = 3;
+  TerrainWindow windows[WINDOW_COUNT];
+  std::atomic<TerrainWindow *> current{&windows[0]};
+  // The update thread's view: 'front' is the published window, 'back' the one being built
+  // (null when idle). The worker only reads 'front' while a job is queued.
+  TerrainWindow *front = &windows[0];
+  TerrainWindow *back = nullptr;
+  TerrainGrid::Representation representation = TerrainGrid::Representation::Grid;
+  TerrainGrid::LateralDetail lateralDetail;
   float difficultyMultiplier = 1.0f; // Increases terrain steepness over distance
-  unsigned int terrainSeed = 0;      // Seed for procedural terrain generation
+  bool streaming = true;
+  bool asyncGeneration = true;
+  float prefetchSeconds = 1.5f;
+  size_t prefetchBudgetBytes = 4 * 1024 * 1024;
+  float corridorHalfWidth = 0.0f;
+  float corridorHalfLength = 0.0f;
+  int corridorSubdivisions = 0;
+  bool vertexOutput = false;
+  bool buildVertices = false; // vertexOutput as of the last init(), read by the worker
+
+  // Pending job parameters and its output
+  GridMove jobGrid;
+  GridMove jobCorridor;
+  std::vector<TerrainGrid::Edit> jobEdits;
+  std::vector<TerrainGrid::Edit> pendingEdits; // deform() calls waiting for the next job
+  int jobEditsApplied = 0;
+  int jobVerticesPatched = 0;
+  float jobDifficulty = 1.0f;
+  float jobElapsedMs = 0.0f;
+  std::vector<TerrainVertex> stagedVertices;
+  std::vector<VertexRun> stagedRuns; // consecutive ranges of stagedVertices
+  std::vector<glm::vec2> stagedChunkHeights;
 
-  // Offset for infinite terrain generation
-  float offsetX = 0.0f;
-  float offsetZ = 0.0f;
+  std::thread worker;
+  std::mutex jobMutex;
+  std::condition_variable jobCv;
+  JobState jobState = JobState::Idle;
+  bool workerQuit = false;
 
-  std::vector<float> heights; // size width*depth
+  unsigned int revision = 0;
+  float lastPlayerZ = 0.0f;
+  float travelDirZ = -1.0f;
+  float lastViewDistance = 0.0f;
+  TerrainStats stats;
 
-  GLuint VAO = 0;
-  GLuint VBO = 0;
-  GLuint EBO = 0;
-  GLsizei indexCount = 0;
+  // (min, max) vertex height per chunk of 'front', indexed by physical chunk row * chunks across
+  std::vector<glm::vec2> chunkHeights;
+  // Published vertex changes not taken yet
+  VertexUpdate pendingVertices;
 };
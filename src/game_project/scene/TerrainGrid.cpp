@@ -0,0 +1,926 @@
+#include "TerrainGrid.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+  int floorDiv(int a, int b)
+  {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+  }
+  int ringSlot(int tileRow, int rows)
+  {
+    int slot = tileRow % rows;
+    return slot < 0 ? slot + rows : slot;
+  }
+}
+
+void TerrainGrid::init(int w, int d, float s, float hscale, unsigned int seed)
+{
+  width = w;
+  depth = d;
+  scale = s;
+  heightScale = hscale;
+  terrainSeed = seed;
+  noiseParams = NoiseParams::fromSeed(seed);
+
+  offsetX = 0.0f;
+  offsetZ = 0.0f;
+  ringStart = 0;
+  rowOrigin = -depth / 2;
+
+  rawProfile.assign(depth + 1, 0.0f);
+  heights.clear();
+  rawHeights.clear();
+  quantHeights.clear();
+  blockQuant.clear();
+  blockCols = 0;
+  profile.clear();
+  slopes.clear();
+  edits.clear();
+  if (representation == Representation::Profile)
+  {
+    profile.assign(depth + 1, 0.0f);
+  }
+  else if (representation == Representation::Quantized)
+  {
+    // Raw rows are rebuilt from rawProfile when smoothing, so only the codes are stored
+    blockCols = (width + QUANT_BLOCK - 1) / QUANT_BLOCK;
+    quantHeights.assign(width * depth, 0);
+    blockQuant.assign((depth + QUANT_BLOCK - 1) / QUANT_BLOCK * blockCols, glm::vec2(0.0f));
+    slopes.assign(2 * width * (depth + 1), 0);
+  }
+  else
+  {
+    heights.assign(width * (depth + 1), 0.0f);
+    rawHeights.assign(width * (depth + 1), 0.0f);
+    slopes.assign(2 * width * (depth + 1), 0);
+  }
+
+  // Levels up to a single tile across the window
+  pyramid.clear();
+  for (int size = PYRAMID_TILE;; size *= 2)
+  {
+    PyramidLevel level;
+    level.size = size;
+    level.cols = std::max((width - 1 + size - 1) / size, 1);
+    level.rows = std::max((depth - 1 + size - 1) / size, 1) + 1;
+    level.bounds.assign(level.cols * level.rows, glm::vec2(0.0f));
+    pyramid.push_back(std::move(level));
+    if (size >= width - 1 && size >= depth - 1)
+      break;
+  }
+
+  regenerate();
+}
+
+void TerrainGrid::clear()
+{
+  heights.clear();
+  rawHeights.clear();
+  quantHeights.clear();
+  blockQuant.clear();
+  profile.clear();
+  rawProfile.clear();
+  slopes.clear();
+  edits.clear();
+  pyramid.clear();
+  width = 0;
+  depth = 0;
+}
+
+void TerrainGrid::regenerate()
+{
+  sampleRows(0, depth);
+
+  // Apply smoothing to make terrain transitions more gradual
+  smoothRows(0, depth);
+  updateSlopes(0, depth);
+  updatePyramid(0, depth);
+}
+
+void TerrainGrid::moveTo(float newOffsetX, int shiftRows)
+{
+  offsetX = newOffsetX;
+  offsetZ += shiftRows * scale;
+  rowOrigin += shiftRows;
+  regenerate();
+}
+
+void TerrainGrid::streamRows(int shiftRows, RowRanges &dirtyRows)
+{
+  const int halo = smoothHalo();
+
+  // Quantized blocks must stay aligned with the ring rows, so other shifts rebuild the window
+  bool blocksAligned = representation != Representation::Quantized || (shiftRows % QUANT_BLOCK == 0 && depth % QUANT_BLOCK == 0);
+  if (std::abs(shiftRows) >= depth - 2 * halo || !blocksAligned)
+  {
+    // Nothing survives the shift: regenerate the whole window
+    moveTo(offsetX, shiftRows);
+    dirtyRows.push_back({0, depth});
+    return;
+  }
+
+  offsetZ += shiftRows * scale;
+  rowOrigin += shiftRows;
+  ringStart = ((ringStart + shiftRows) % depth + depth) % depth;
+
+  // Only the newly exposed rows are sampled. Smoothing is redone for the new rows plus a halo
+  // on both window edges, since the rows next to the old edge are no longer on the edge and
+  // the rows next to the new opposite edge now are. Normals reach one row further.
+  if (shiftRows > 0)
+  {
+    int firstNew = depth - shiftRows;
+    sampleRows(firstNew, depth);
+    smoothRows(firstNew - halo, depth);
+    smoothRows(0, halo);
+    dirtyRows.push_back({std::max(firstNew - halo - 1, 0), depth});
+    dirtyRows.push_back({0, halo + 1});
+  }
+  else
+  {
+    int lastNew = -shiftRows;
+    sampleRows(0, lastNew);
+    smoothRows(0, lastNew + halo);
+    smoothRows(depth - halo, depth);
+    dirtyRows.push_back({0, std::min(lastNew + halo + 1, depth)});
+    dirtyRows.push_back({depth - halo - 1, depth});
+  }
+
+  // The rows whose vertices changed are exactly the rows whose slopes changed
+  for (size_t i = dirtyRows.size() - 2; i < dirtyRows.size(); ++i)
+  {
+    updateSlopes(dirtyRows[i].first, dirtyRows[i].second);
+    updatePyramid(dirtyRows[i].first, dirtyRows[i].second);
+  }
+}
+
+void TerrainGrid::smoothRows(int firstRow, int lastRow)
+{
+  firstRow = std::max(firstRow, 0);
+  lastRow = std::min(lastRow, depth);
+  if (width < 2 || depth < 2 || firstRow >= lastRow)
+    return;
+
+  if (representation == Representation::Profile)
+  {
+    smoothProfile(firstRow, lastRow);
+    return;
+  }
+  if (representation == Representation::Quantized)
+  {
+    // Blocks are encoded from all of their smoothed heights, so smooth whole blocks
+    firstRow = firstRow / QUANT_BLOCK * QUANT_BLOCK;
+    lastRow = std::min((lastRow + QUANT_BLOCK - 1) / QUANT_BLOCK * QUANT_BLOCK, depth);
+  }
+
+  // Every pass of the box blur reads the radius further out, so the band is rebuilt from the
+  // raw samples with a smoothHalo() row halo. Rows and columns on the window edge
+  // stay unsmoothed, exactly as when the whole grid is filtered.
+  const int R = smoothRadius;
+  const int halo = smoothHalo();
+  const double norm = 1.0 / ((2 * R + 1) * (2 * R + 1));
+  int bandFirst = std::max(firstRow - halo, 0);
+  int bandLast = std::min(lastRow + halo, depth);
+  int bandRows = bandLast - bandFirst;
+
+  // Ping-pong between two band buffers. Cells the blur never writes (window and band edges)
+  // are filled once in both, so each pass only has to write the interior.
+  std::vector<float> &src = scratch.bandA;
+  std::vector<float> &dst = scratch.bandB;
+  std::vector<double> &rowSums = scratch.rowSums;
+  std::vector<double> &colSums = scratch.colSums;
+  src.resize(bandRows * width);
+  dst.resize(bandRows * width);
+  rowSums.resize(bandRows * width);
+  colSums.resize(width);
+  for (int r = 0; r < bandRows; ++r)
+    rawRow(bandFirst + r, &src[r * width]);
+  std::copy(src.begin(), src.end(), dst.begin());
+
+  // Rows of the band the blur writes: not on the band halo edge, not on the window edge
+  const int rowBegin = std::max(R, R - bandFirst);
+  const int rowEnd = std::min(bandRows - R, depth - R - bandFirst);
+
+  if (width > 2 * R && rowBegin < rowEnd)
+  {
+    for (int iter = 0; iter < SMOOTH_ITERATIONS; ++iter)
+    {
+      // Horizontal pass: running sum of 2R+1 neighbours along each row
+      for (int r = 0; r < bandRows; ++r)
+      {
+        const float *in = &src[r * width];
+        double *sums = &rowSums[r * width];
+        double sum = 0.0;
+        for (int ix = 0; ix <= 2 * R; ++ix)
+          sum += in[ix];
+        sums[R] = sum;
+        for (int ix = R + 1; ix < width - R; ++ix)
+        {
+          sum += in[ix + R] - in[ix - R - 1];
+          sums[ix] = sum;
+        }
+      }
+
+      // Vertical pass: running sum of 2R+1 row sums down each column
+      for (int ix = R; ix < width - R; ++ix)
+      {
+        double sum = 0.0;
+        for (int r = rowBegin - R; r <= rowBegin + R; ++r)
+          sum += rowSums[r * width + ix];
+        colSums[ix] = sum;
+      }
+      for (int r = rowBegin; r < rowEnd; ++r)
+      {
+        float *out = &dst[r * width];
+        if (r > rowBegin)
+        {
+          const double *add = &rowSums[(r + R) * width];
+          const double *sub = &rowSums[(r - R - 1) * width];
+          for (int ix = R; ix < width - R; ++ix)
+            colSums[ix] += add[ix] - sub[ix];
+        }
+        for (int ix = R; ix < width - R; ++ix)
+          out[ix] = static_cast<float>(colSums[ix] * norm);
+      }
+
+      std::swap(src, dst);
+    }
+  }
+
+  storeRows(firstRow, lastRow, src, bandFirst);
+}
+
+void TerrainGrid::rawRow(int logicalRow, float *out) const
+{
+  int row = physicalRow(logicalRow);
+  if (!rawHeights.empty())
+  {
+    std::copy(&rawHeights[row * width], &rawHeights[row * width] + width, out);
+    return;
+  }
+
+  // Same values sampleRows writes for the Grid representation
+  float h = rawProfile[row];
+  if (lateralDetail)
+  {
+    float wz = (logicalRow - depth / 2) * scale + offsetZ;
+    for (int ix = 0; ix < width; ++ix)
+      out[ix] = h + lateralDetail((ix - width / 2) * scale + offsetX, wz);
+  }
+  else
+  {
+    std::fill(out, out + width, h);
+  }
+  for (const Edit &edit : edits)
+    addEdit(edit, logicalRow, out);
+}
+
+void TerrainGrid::addEdit(const Edit &edit, int logicalRow, float *out) const
+{
+  const float dz = getMinZ() + logicalRow * scale - edit.z;
+  if (std::abs(dz) >= edit.radius)
+    return;
+  const float reach = std::sqrt(edit.radius * edit.radius - dz * dz);
+  const int firstCol = std::max(static_cast<int>(std::ceil((edit.x - reach - getMinX()) / scale)), 0);
+  const int lastCol = std::min(static_cast<int>(std::floor((edit.x + reach - getMinX()) / scale)) + 1, width);
+  const float invRadius2 = 1.0f / (edit.radius * edit.radius);
+  for (int ix = firstCol; ix < lastCol; ++ix)
+  {
+    float dx = getMinX() + ix * scale - edit.x;
+    float f = 1.0f - (dx * dx + dz * dz) * invRadius2;
+    if (f > 0.0f)
+      out[ix] -= edit.depth * f * f;
+  }
+}
+
+bool TerrainGrid::deform(const Edit &edit, CellRect &changed)
+{
+  if (edit.radius <= 0.0f)
+    return false;
+  edits.push_back(edit);
+  if (edits.size() > MAX_EDITS)
+    edits.erase(edits.begin());
+  if (representation == Representation::Profile || width < 2 || depth < 2)
+    return false;
+
+  // Raw samples the edit reaches
+  const int firstCol = std::max(static_cast<int>(std::ceil((edit.x - edit.radius - getMinX()) / scale)), 0);
+  const int lastCol = std::min(static_cast<int>(std::floor((edit.x + edit.radius - getMinX()) / scale)) + 1, width);
+  const int firstRow = std::max(static_cast<int>(std::ceil((edit.z - edit.radius - getMinZ()) / scale)), 0);
+  const int lastRow = std::min(static_cast<int>(std::floor((edit.z + edit.radius - getMinZ()) / scale)) + 1, depth);
+  if (firstCol >= lastCol || firstRow >= lastRow)
+    return false;
+
+  // Quantized rebuilds its raw rows from the stored edits; Grid adds this one in place
+  if (representation == Representation::Grid)
+  {
+    for (int iz = firstRow; iz < lastRow; ++iz)
+    {
+      int row = physicalRow(iz);
+      float *out = &rawHeights[row * width];
+      addEdit(edit, iz, out);
+      if (row == 0)
+        std::copy(out, out + width, rawHeights.begin() + depth * width);
+    }
+  }
+
+  // Smoothing spreads the change by the halo, and whole blocks are re-encoded for Quantized
+  const int halo = smoothHalo();
+  CellRect rect{firstCol - halo, lastCol + halo, firstRow - halo, lastRow + halo};
+  if (representation == Representation::Quantized)
+  {
+    rect.firstCol = floorDiv(rect.firstCol, QUANT_BLOCK) * QUANT_BLOCK;
+    rect.lastCol = -floorDiv(-rect.lastCol, QUANT_BLOCK) * QUANT_BLOCK;
+    rect.firstRow = floorDiv(rect.firstRow, QUANT_BLOCK) * QUANT_BLOCK;
+    rect.lastRow = -floorDiv(-rect.lastRow, QUANT_BLOCK) * QUANT_BLOCK;
+  }
+  smoothRows(rect.firstRow, rect.lastRow);
+
+  // Slopes (and so vertex normals) reach one vertex further
+  changed.firstCol = std::max(rect.firstCol - 1, 0);
+  changed.lastCol = std::min(rect.lastCol + 1, width);
+  changed.firstRow = std::max(rect.firstRow - 1, 0);
+  changed.lastRow = std::min(rect.lastRow + 1, depth);
+  updateSlopes(changed.firstRow, changed.lastRow);
+  updatePyramid(changed.firstRow, changed.lastRow);
+  return true;
+}
+
+void TerrainGrid::storeRows(int firstRow, int lastRow, const std::vector<float> &band, int bandFirst)
+{
+  if (representation == Representation::Grid)
+  {
+    for (int iz = firstRow; iz < lastRow; ++iz)
+    {
+      int row = physicalRow(iz);
+      std::copy(band.begin() + (iz - bandFirst) * width, band.begin() + (iz - bandFirst + 1) * width, heights.begin() + row * width);
+      if (row == 0)
+        std::copy(heights.begin(), heights.begin() + width, heights.begin() + depth * width);
+    }
+    return;
+  }
+
+  // Quantized: each block gets the (min, step) that spans its own heights exactly
+  for (int b0 = firstRow; b0 < lastRow; b0 += QUANT_BLOCK)
+  {
+    int b1 = std::min(b0 + QUANT_BLOCK, lastRow);
+    glm::vec2 *quant = &blockQuant[physicalRow(b0) / QUANT_BLOCK * blockCols];
+    for (int bc = 0; bc < blockCols; ++bc)
+    {
+      int c0 = bc * QUANT_BLOCK;
+      int c1 = std::min(c0 + QUANT_BLOCK, width);
+      float lo = std::numeric_limits<float>::max();
+      float hi = std::numeric_limits<float>::lowest();
+      for (int iz = b0; iz < b1; ++iz)
+      {
+        const float *in = &band[(iz - bandFirst) * width];
+        for (int ix = c0; ix < c1; ++ix)
+        {
+          lo = std::min(lo, in[ix]);
+          hi = std::max(hi, in[ix]);
+        }
+      }
+
+      const float step = (hi - lo) / 65535.0f;
+      const float invStep = step > 0.0f ? 1.0f / step : 0.0f;
+      quant[bc] = glm::vec2(lo, step);
+      for (int iz = b0; iz < b1; ++iz)
+      {
+        const float *in = &band[(iz - bandFirst) * width];
+        uint16_t *out = &quantHeights[physicalRow(iz) * width];
+        for (int ix = c0; ix < c1; ++ix)
+          out[ix] = static_cast<uint16_t>(std::min(std::lround((in[ix] - lo) * invStep), 65535L));
+      }
+    }
+  }
+}
+
+void TerrainGrid::smoothProfile(int firstRow, int lastRow)
+{
+  // Same band/halo scheme as the grid filter, with a running-sum box along Z
+  const int R = smoothRadius;
+  const int halo = smoothHalo();
+  const double norm = 1.0 / (2 * R + 1);
+  int bandFirst = std::max(firstRow - halo, 0);
+  int bandLast = std::min(lastRow + halo, depth);
+  int bandRows = bandLast - bandFirst;
+
+  std::vector<float> &src = scratch.bandA;
+  std::vector<float> &dst = scratch.bandB;
+  src.resize(bandRows);
+  dst.resize(bandRows);
+  for (int r = 0; r < bandRows; ++r)
+    src[r] = rawProfile[physicalRow(bandFirst + r)];
+  std::copy(src.begin(), src.end(), dst.begin());
+
+  const int rowBegin = std::max(R, R - bandFirst);
+  const int rowEnd = std::min(bandRows - R, depth - R - bandFirst);
+
+  if (rowBegin < rowEnd)
+  {
+    for (int iter = 0; iter < SMOOTH_ITERATIONS; ++iter)
+    {
+      double sum = 0.0;
+      for (int r = rowBegin - R; r <= rowBegin + R; ++r)
+        sum += src[r];
+      dst[rowBegin] = static_cast<float>(sum * norm);
+      for (int r = rowBegin + 1; r < rowEnd; ++r)
+      {
+        sum += src[r + R] - src[r - R - 1];
+        dst[r] = static_cast<float>(sum * norm);
+      }
+      std::swap(src, dst);
+    }
+  }
+
+  for (int iz = firstRow; iz < lastRow; ++iz)
+    profile[physicalRow(iz)] = src[iz - bandFirst];
+  profile[depth] = profile[0];
+}
+
+void TerrainGrid::sampleRows(int firstRow, int lastRow)
+{
+  // Every pattern depends on z only, so the noise is sampled once per row (a whole
+  // column of rows per batch) and the grid representation broadcasts it across the row
+  const int count = lastRow - firstRow;
+  if (count <= 0)
+    return;
+  scratch.sampleZ.resize(count);
+  scratch.sampleOut.resize(count);
+  for (int i = 0; i < count; ++i)
+    scratch.sampleZ[i] = (firstRow + i - depth / 2) * scale + offsetZ;
+  sampleNoiseBatch(noiseParams, scratch.sampleZ.data(), count, scratch.sampleOut.data());
+
+  const float amplitude = heightScale * difficultyMultiplier;
+  for (int iz = firstRow; iz < lastRow; ++iz)
+  {
+    int row = physicalRow(iz);
+    float wz = scratch.sampleZ[iz - firstRow];
+    float h = scratch.sampleOut[iz - firstRow] * amplitude;
+    rawProfile[row] = h;
+
+    if (representation == Representation::Grid)
+    {
+      float *out = &rawHeights[row * width];
+      if (lateralDetail)
+      {
+        for (int ix = 0; ix < width; ++ix)
+          out[ix] = h + lateralDetail((ix - width / 2) * scale + offsetX, wz);
+      }
+      else
+      {
+        std::fill(out, out + width, h);
+      }
+      for (const Edit &edit : edits)
+        addEdit(edit, iz, out);
+      if (row == 0)
+        std::copy(out, out + width, rawHeights.begin() + depth * width);
+    }
+  }
+  rawProfile[depth] = rawProfile[0];
+}
+
+void TerrainGrid::updateSlopes(int firstRow, int lastRow)
+{
+  if (slopes.empty())
+    return;
+  firstRow = std::max(firstRow, 0);
+  lastRow = std::min(lastRow, depth);
+  const float LIMIT = 32767.0f;
+  for (int iz = firstRow; iz < lastRow; ++iz)
+  {
+    int row = physicalRow(iz);
+    int16_t *out = &slopes[2 * row * width];
+    for (int ix = 0; ix < width; ++ix)
+    {
+      glm::vec2 s = slopeAt(ix, iz) / SLOPE_STEP;
+      out[2 * ix] = static_cast<int16_t>(std::lround(std::clamp(s.x, -LIMIT, LIMIT)));
+      out[2 * ix + 1] = static_cast<int16_t>(std::lround(std::clamp(s.y, -LIMIT, LIMIT)));
+    }
+    if (row == 0)
+      std::copy(out, out + 2 * width, slopes.begin() + 2 * depth * width);
+  }
+}
+
+void TerrainGrid::updatePyramid(int firstRow, int lastRow)
+{
+  firstRow = std::max(firstRow, 0);
+  lastRow = std::min(lastRow, depth);
+  if (pyramid.empty() || width < 2 || depth < 2 || firstRow >= lastRow)
+    return;
+
+  // Global rows of the window, and of the changed vertices
+  const int windowFirst = rowOrigin;
+  const int windowLast = rowOrigin + depth - 1;
+  const int changedFirst = rowOrigin + firstRow;
+  const int changedLast = rowOrigin + lastRow - 1;
+
+  for (size_t l = 0; l < pyramid.size(); ++l)
+  {
+    PyramidLevel &level = pyramid[l];
+    const int size = level.size;
+    // Tiles covering a changed vertex row, clamped to the tiles that overlap the window
+    int tileFirst = std::max(floorDiv(changedFirst - 1, size), floorDiv(windowFirst, size));
+    int tileLast = std::min(floorDiv(changedLast, size), floorDiv(windowLast, size));
+    for (int tz = tileFirst; tz <= tileLast; ++tz)
+    {
+      glm::vec2 *out = &level.bounds[ringSlot(tz, level.rows) * level.cols];
+      int rowFirst = std::max(tz * size, windowFirst) - rowOrigin;
+      int rowLast = std::min(tz * size + size, windowLast) - rowOrigin;
+      for (int tx = 0; tx < level.cols; ++tx)
+      {
+        if (l == 0)
+        {
+          getHeightRange(tx * size, std::min(tx * size + size + 1, width), rowFirst, rowLast + 1, out[tx].x, out[tx].y);
+          continue;
+        }
+
+        // Union of the (up to) four children that overlap the window
+        const PyramidLevel &child = pyramid[l - 1];
+        glm::vec2 range(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+        for (int cz = 2 * tz; cz <= 2 * tz + 1; ++cz)
+        {
+          if (cz * child.size > windowLast || cz * child.size + child.size < windowFirst)
+            continue;
+          const glm::vec2 *in = &child.bounds[ringSlot(cz, child.rows) * child.cols];
+          for (int cx = 2 * tx; cx <= 2 * tx + 1 && cx < child.cols; ++cx)
+          {
+            range.x = std::min(range.x, in[cx].x);
+            range.y = std::max(range.y, in[cx].y);
+          }
+        }
+        out[tx] = range;
+      }
+    }
+  }
+}
+
+bool TerrainGrid::raycastCell(int ix, int logicalRow, const glm::vec3 &p, const glm::vec3 &dir, float len, float &outDist) const
+{
+  // Along the segment the bilinear patch is a quadratic in s, so is the ray's height above it:
+  // f(s) = f0 + f1 s + f2 s^2. The hit is the first s in [0, len] with f(s) <= 0.
+  const double h00 = heightAt(ix, logicalRow);
+  const double h10 = heightAt(ix + 1, logicalRow);
+  const double h01 = heightAt(ix, logicalRow + 1);
+  const double h11 = heightAt(ix + 1, logicalRow + 1);
+  const double b = h10 - h00;
+  const double c = h01 - h00;
+  const double d = h00 - h10 - h01 + h11;
+
+  const double u0 = (p.x - offsetX) / scale + width / 2 - ix;
+  const double v0 = (p.z - offsetZ) / scale + depth / 2 - logicalRow;
+  const double du = dir.x / scale;
+  const double dv = dir.z / scale;
+
+  const double f0 = p.y - (h00 + b * u0 + c * v0 + d * u0 * v0);
+  const double f1 = dir.y - (b * du + c * dv + d * (u0 * dv + v0 * du));
+  const double f2 = -d * du * dv;
+
+  double s = -1.0;
+  if (f0 <= 0.0)
+  {
+    s = 0.0;
+  }
+  else if (std::abs(f2) < 1e-12)
+  {
+    if (f1 < 0.0)
+      s = -f0 / f1;
+  }
+  else
+  {
+    double disc = f1 * f1 - 4.0 * f2 * f0;
+    if (disc >= 0.0)
+    {
+      // Stable form of the two roots; with f0 > 0 the first non-negative one is the crossing
+      double q = -0.5 * (f1 + (f1 >= 0.0 ? std::sqrt(disc) : -std::sqrt(disc)));
+      double r1 = q / f2;
+      double r2 = q != 0.0 ? f0 / q : r1;
+      if (r1 > r2)
+        std::swap(r1, r2);
+      s = r1 >= 0.0 ? r1 : r2;
+    }
+  }
+  if (s < 0.0 || s > len)
+    return false;
+  outDist = static_cast<float>(s);
+  return true;
+}
+
+bool TerrainGrid::raycast(const glm::vec3 &origin, const glm::vec3 &dirIn, float maxDist, float &outDist) const
+{
+  float dirLength = glm::length(dirIn);
+  if (pyramid.empty() || width < 2 || depth < 2 || dirLength <= 0.0f || maxDist <= 0.0f)
+    return false;
+  const glm::vec3 dir = dirIn / dirLength;
+
+  // Work in grid units: x in [0, width-1] columns, z in [0, depth-1] logical rows
+  const float gx0 = (origin.x - offsetX) / scale + width / 2;
+  const float gz0 = (origin.z - offsetZ) / scale + depth / 2;
+  const float gdx = dir.x / scale;
+  const float gdz = dir.z / scale;
+
+  // Clip the ray to the window
+  float tEnter = 0.0f;
+  float tLeave = maxDist;
+  auto clip = [&](float p, float d, float lo, float hi)
+  {
+    if (std::abs(d) < 1e-12f)
+      return p >= lo && p <= hi;
+    float t0 = (lo - p) / d;
+    float t1 = (hi - p) / d;
+    if (t0 > t1)
+      std::swap(t0, t1);
+    tEnter = std::max(tEnter, t0);
+    tLeave = std::min(tLeave, t1);
+    return tEnter <= tLeave;
+  };
+  if (!clip(gx0, gdx, 0.0f, static_cast<float>(width - 1)) || !clip(gz0, gdz, 0.0f, static_cast<float>(depth - 1)))
+    return false;
+
+  // Exit distance of the axis-aligned square [lo, lo + size] on each axis
+  auto exitT = [&](float p, float d, int lo, int size)
+  {
+    if (d > 1e-12f)
+      return (lo + size - p) / d;
+    if (d < -1e-12f)
+      return (lo - p) / d;
+    return std::numeric_limits<float>::max();
+  };
+
+  // Descend where the ray may touch a tile, skip tiles it passes over, and step back up a
+  // level after each skip so open stretches are crossed in large strides
+  const float EPS = 1e-4f;
+  const int top = static_cast<int>(pyramid.size()) - 1;
+  int level = top;
+  float t = tEnter;
+  while (t <= tLeave)
+  {
+    // The tile containing the ray just past t; level -1 is a single cell
+    const float probe = std::min(t + EPS, tLeave);
+    const float px = gx0 + gdx * probe;
+    const float pz = gz0 + gdz * probe;
+    const int size = level >= 0 ? pyramid[level].size : 1;
+    int cx = std::clamp(static_cast<int>(std::floor(px)), 0, width - 2);
+    int cz = std::clamp(static_cast<int>(std::floor(pz)), 0, depth - 2);
+    int tx = cx / size;
+    int tz = floorDiv(rowOrigin + cz, size);
+
+    float tExit = std::min(exitT(gx0 + gdx * t, gdx, tx * size, size) + t,
+                           exitT(gz0 + gdz * t, gdz, tz * size - rowOrigin, size) + t);
+    tExit = std::min(std::max(tExit, t + EPS), tLeave);
+
+    if (level < 0)
+    {
+      float s;
+      if (raycastCell(cx, cz, origin + dir * t, dir, tExit - t, s))
+      {
+        outDist = t + s;
+        return true;
+      }
+    }
+    else
+    {
+      const PyramidLevel &tiles = pyramid[level];
+      const glm::vec2 &range = tiles.bounds[ringSlot(tz, tiles.rows) * tiles.cols + std::min(tx, tiles.cols - 1)];
+      float rayLow = std::min(origin.y + dir.y * t, origin.y + dir.y * tExit);
+      if (rayLow <= range.y)
+      {
+        level--;
+        continue;
+      }
+    }
+
+    if (tExit >= tLeave)
+      break;
+    t = tExit;
+    level = std::min(level + 1, top);
+  }
+  return false;
+}
+
+float TerrainGrid::heightAt(int ix, int logicalRow) const
+{
+  ix = std::clamp(ix, 0, width - 1);
+  logicalRow = std::clamp(logicalRow, 0, depth - 1);
+  if (representation == Representation::Profile)
+  {
+    float h = profile[physicalRow(logicalRow)];
+    if (lateralDetail)
+      h += lateralDetail((ix - width / 2) * scale + offsetX, (logicalRow - depth / 2) * scale + offsetZ);
+    return h;
+  }
+  if (representation == Representation::Quantized)
+    return decodeHeight(physicalRow(logicalRow), ix);
+  return heights[physicalRow(logicalRow) * width + ix];
+}
+
+glm::vec2 TerrainGrid::slopeAt(int ix, int logicalRow) const
+{
+  // Same stencil as the old per-vertex normals: the clamped neighbours make edges one-sided
+  float dx = heightAt(ix + 1, logicalRow) - heightAt(ix - 1, logicalRow);
+  float dz = heightAt(ix, logicalRow + 1) - heightAt(ix, logicalRow - 1);
+  return glm::vec2(dx, dz) / (2.0f * scale);
+}
+
+glm::vec2 TerrainGrid::getSlope(float x, float z) const
+{
+  if (width < 2 || depth < 2)
+    return glm::vec2(0.0f);
+  if (slopes.empty())
+  {
+    float h, dx, dz;
+    sampleBatch(&x, &z, 1, &h, &dx, &dz);
+    return glm::vec2(dx, dz);
+  }
+
+  float fx = ((x - offsetX) / scale) + static_cast<float>(width / 2);
+  float fz = ((z - offsetZ) / scale) + static_cast<float>(depth / 2);
+  int ix = static_cast<int>(std::floor(fx));
+  int iz = static_cast<int>(std::floor(fz));
+  float tx = std::clamp(fx - ix, 0.0f, 1.0f);
+  float tz = std::clamp(fz - iz, 0.0f, 1.0f);
+
+  int x0 = 2 * std::clamp(ix, 0, width - 1);
+  int x1 = 2 * std::clamp(ix + 1, 0, width - 1);
+  const int16_t *s0 = &slopes[2 * physicalRow(std::clamp(iz, 0, depth - 1)) * width];
+  const int16_t *s1 = &slopes[2 * physicalRow(std::clamp(iz + 1, 0, depth - 1)) * width];
+
+  glm::vec2 a = glm::mix(glm::vec2(s0[x0], s0[x0 + 1]), glm::vec2(s0[x1], s0[x1 + 1]), tx);
+  glm::vec2 b = glm::mix(glm::vec2(s1[x0], s1[x0 + 1]), glm::vec2(s1[x1], s1[x1 + 1]), tx);
+  return glm::mix(a, b, tz) * SLOPE_STEP;
+}
+
+void TerrainGrid::sampleHeights(const float *x, const float *z, int count, float *outHeight) const
+{
+  sampleBatch(x, z, count, outHeight, nullptr, nullptr);
+}
+
+void TerrainGrid::sampleHeightsAndGradients(const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz) const
+{
+  sampleBatch(x, z, count, outHeight, outDx, outDz);
+}
+
+void TerrainGrid::sampleBatch(const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz) const
+{
+  const bool gradients = outDx && outDz;
+  if (width < 2 || depth < 2)
+  {
+    std::fill(outHeight, outHeight + count, 0.0f);
+    if (gradients)
+    {
+      std::fill(outDx, outDx + count, 0.0f);
+      std::fill(outDz, outDz + count, 0.0f);
+    }
+    return;
+  }
+
+  if (representation == Representation::Profile)
+  {
+    const float halfDepth = static_cast<float>(depth / 2);
+    const float invScale = 1.0f / scale;
+    // Detail is an arbitrary callback, so its slope is taken by central difference
+    const float EPS = 0.05f * scale;
+    for (int i = 0; i < count; ++i)
+    {
+      float fz = ((z[i] - offsetZ) / scale) + halfDepth;
+      int iz = static_cast<int>(std::floor(fz));
+      float tz = fz - iz;
+      int r0 = physicalRow(std::clamp(iz, 0, depth - 1));
+      int r1 = physicalRow(std::clamp(iz + 1, 0, depth - 1));
+      outHeight[i] = profile[r0] * (1 - tz) + profile[r1] * tz + detailAt(x[i], z[i]);
+      if (gradients)
+      {
+        outDx[i] = (detailAt(x[i] + EPS, z[i]) - detailAt(x[i] - EPS, z[i])) / (2.0f * EPS);
+        outDz[i] = (profile[r1] - profile[r0]) * invScale + (detailAt(x[i], z[i] + EPS) - detailAt(x[i], z[i] - EPS)) / (2.0f * EPS);
+      }
+    }
+    return;
+  }
+
+  if (representation == Representation::Quantized)
+  {
+    sampleGrid([this](int row, int ix)
+               { return decodeHeight(row, ix); },
+               x, z, count, outHeight, outDx, outDz);
+    return;
+  }
+  const float *h = heights.data();
+  const int w = width;
+  sampleGrid([h, w](int row, int ix)
+             { return h[row * w + ix]; },
+             x, z, count, outHeight, outDx, outDz);
+}
+
+template <class Fetch>
+void TerrainGrid::sampleGrid(Fetch fetch, const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz) const
+{
+  const bool gradients = outDx && outDz;
+  const float halfWidth = static_cast<float>(width / 2);
+  const float halfDepth = static_cast<float>(depth / 2);
+  const float invScale = 1.0f / scale;
+
+  // Straight-line loop over independent points: index math, four loads and a bilinear blend
+  for (int i = 0; i < count; ++i)
+  {
+    float fx = ((x[i] - offsetX) / scale) + halfWidth;
+    float fz = ((z[i] - offsetZ) / scale) + halfDepth;
+    int ix = static_cast<int>(std::floor(fx));
+    int iz = static_cast<int>(std::floor(fz));
+    float tx = fx - ix;
+    float tz = fz - iz;
+
+    int x0 = std::clamp(ix, 0, width - 1);
+    int x1 = std::clamp(ix + 1, 0, width - 1);
+    int r0 = std::clamp(iz, 0, depth - 1) + ringStart;
+    int r1 = std::clamp(iz + 1, 0, depth - 1) + ringStart;
+    r0 = r0 >= depth ? r0 - depth : r0;
+    r1 = r1 >= depth ? r1 - depth : r1;
+
+    float h00 = fetch(r0, x0);
+    float h10 = fetch(r0, x1);
+    float h01 = fetch(r1, x0);
+    float h11 = fetch(r1, x1);
+    float hx0 = h00 * (1 - tx) + h10 * tx;
+    float hx1 = h01 * (1 - tx) + h11 * tx;
+    outHeight[i] = hx0 * (1 - tz) + hx1 * tz;
+    if (gradients)
+    {
+      outDx[i] = ((h10 - h00) * (1 - tz) + (h11 - h01) * tz) * invScale;
+      outDz[i] = (hx1 - hx0) * invScale;
+    }
+  }
+}
+
+void TerrainGrid::getHeightBounds(float &minY, float &maxY) const
+{
+  minY = 0.0f;
+  maxY = 0.0f;
+  if (pyramid.empty() || width < 2 || depth < 2)
+    return;
+
+  // The top level has one tile column and a couple of tile rows; use the ones in the window
+  const PyramidLevel &top = pyramid.back();
+  minY = std::numeric_limits<float>::max();
+  maxY = std::numeric_limits<float>::lowest();
+  for (int tz = floorDiv(rowOrigin, top.size); tz <= floorDiv(rowOrigin + depth - 1, top.size); ++tz)
+  {
+    int slot = ringSlot(tz, top.rows);
+    for (int tx = 0; tx < top.cols; ++tx)
+    {
+      minY = std::min(minY, top.bounds[slot * top.cols + tx].x);
+      maxY = std::max(maxY, top.bounds[slot * top.cols + tx].y);
+    }
+  }
+}
+
+size_t TerrainGrid::getStorageBytes() const
+{
+  return heights.size() * sizeof(float) + rawHeights.size() * sizeof(float) + quantHeights.size() * sizeof(uint16_t) +
+         blockQuant.size() * sizeof(glm::vec2) + profile.size() * sizeof(float) + rawProfile.size() * sizeof(float) +
+         slopes.size() * sizeof(int16_t);
+}
+
+void TerrainGrid::getHeightRange(int firstCol, int lastCol, int firstRow, int lastRow, float &minY, float &maxY) const
+{
+  minY = std::numeric_limits<float>::max();
+  maxY = std::numeric_limits<float>::lowest();
+  for (int iz = firstRow; iz < lastRow; ++iz)
+  {
+    for (int ix = firstCol; ix < lastCol; ++ix)
+    {
+      float h = heightAt(ix, iz);
+      minY = std::min(minY, h);
+      maxY = std::max(maxY, h);
+    }
+  }
+}
+
+void TerrainGrid::buildRowVertices(int logicalRow, TerrainVertex *out) const
+{
+  float wz = (logicalRow - depth / 2) * scale + offsetZ;
+  const int16_t *rowSlopes = slopes.empty() ? nullptr : &slopes[2 * physicalRow(logicalRow) * width];
+  for (int ix = 0; ix < width; ++ix)
+  {
+    glm::vec2 slope = rowSlopes ? glm::vec2(rowSlopes[2 * ix], rowSlopes[2 * ix + 1]) * SLOPE_STEP : slopeAt(ix, logicalRow);
+    glm::vec3 n = glm::normalize(glm::vec3(-slope.x, 1.0f, -slope.y));
+    TerrainVertex &v = out[ix];
+    v.px = (ix - width / 2) * scale + offsetX;
+    v.py = heightAt(ix, logicalRow);
+    v.pz = wz;
+    v.nx = n.x;
+    v.ny = n.y;
+    v.nz = n.z;
+    v.u = (float)ix / (float)(width - 1);
+    // Texture V follows the global row so it stays continuous while rows stream in
+    v.v = (float)(rowOrigin + logicalRow) / (float)(depth - 1);
+  }
+}
+
+float TerrainGrid::getHeight(float x, float z) const
+{
+  float h;
+  sampleBatch(&x, &z, 1, &h, nullptr, nullptr);
+  return h;
+}
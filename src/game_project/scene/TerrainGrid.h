@@ -0,0 +1,247 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "TerrainNoise.h"
+
+// Interleaved vertex layout uploaded for the terrain mesh
+struct TerrainVertex
+{
+  float px, py, pz;
+  float nx, ny, nz;
+  float u, v;
+};
+
+// CPU side of the terrain: a window of height rows centered on (offsetX, offsetZ).
+// Contains no GL state, so a worker thread can build one while another is being rendered.
+class TerrainGrid
+{
+public:
+  // Logical row ranges [first, last) whose vertices changed and need uploading
+  using RowRanges = std::vector<std::pair<int, int>>;
+
+  // Vertices in columns [firstCol, lastCol) of logical rows [firstRow, lastRow)
+  struct CellRect
+  {
+    int firstCol = 0;
+    int lastCol = 0;
+    int firstRow = 0;
+    int lastRow = 0;
+  };
+
+  // A bowl pressed into the terrain: lowers it by depth at (x,z) (raises it if negative),
+  // falling off smoothly to zero at radius
+  struct Edit
+  {
+    float x = 0.0f;
+    float z = 0.0f;
+    float radius = 0.0f;
+    float depth = 0.0f;
+  };
+  // Edits kept per grid; the oldest is forgotten beyond this
+  static constexpr size_t MAX_EDITS = 1024;
+
+  // Box blur applied to the raw samples: SMOOTH_ITERATIONS passes of a (2*radius+1)^2 box, with
+  // radius SMOOTH_RADIUS unless set otherwise. A row's smoothed height depends on raw rows up
+  // to smoothHalo() away.
+  static constexpr int SMOOTH_ITERATIONS = 2;
+  static constexpr int SMOOTH_RADIUS = 1;
+
+  // Quantized heights share one (min, step) per block of QUANT_BLOCK x QUANT_BLOCK vertices
+  static constexpr int QUANT_BLOCK = 16;
+
+  // Cells per side of the finest min/max pyramid tile; each coarser level doubles it
+  static constexpr int PYRAMID_TILE = 4;
+
+  // Vertex slopes are stored as int16 multiples of SLOPE_STEP (range about +-32, i.e. 88 degrees)
+  static constexpr float SLOPE_STEP = 1.0f / 1024.0f;
+
+  // The terrain noise only varies along Z, so a row can be stored as a single height
+  enum class Representation
+  {
+    Grid,      // width*depth heights (profile broadcast across each row plus lateral detail)
+    Profile,   // one height per row; lateral detail is added when sampling
+    Quantized  // as Grid, but stored as uint16 codes scaled per block and decoded when read.
+               // Each height is within (block max - block min) / 131070 of the Grid value.
+               // The window must move along Z in multiples of QUANT_BLOCK rows.
+  };
+
+  // Optional height added across a row, as a function of world (x,z)
+  using LateralDetail = std::function<float(float x, float z)>;
+
+  // These must be set before init()
+  void setRepresentation(Representation r) { representation = r; }
+  // A grid sampled k times finer than another matches its smoothing footprint with radius (k * (2r + 1) - 1) / 2, k odd
+  void setSmoothRadius(int radius) { smoothRadius = std::max(radius, 0); }
+  void setLateralDetail(LateralDetail detail) { lateralDetail = std::move(detail); }
+  Representation getRepresentation() const { return representation; }
+
+  void init(int width, int depth, float scale, float heightScale, unsigned int seed);
+  void clear();
+
+  // Resample and smooth the whole window at the current offsets
+  void regenerate();
+  // Move the window along Z by whole rows, sampling only the newly exposed rows
+  void streamRows(int shiftRows, RowRanges &dirtyRows);
+  // Move the window along X/Z without streaming (offsetX changes move every vertex)
+  void moveTo(float newOffsetX, int shiftRows);
+
+  void setDifficultyMultiplier(float multiplier) { difficultyMultiplier = multiplier; }
+
+  // Apply an edit to the raw heights and redo smoothing, slopes and the pyramid around it only.
+  // The edit is kept and applied to every row sampled later, so it survives streaming. Returns
+  // false, with 'changed' untouched, if no vertex of the window changed (always for Profile,
+  // which has no per-vertex heights).
+  bool deform(const Edit &edit, CellRect &changed);
+
+  // Sample terrain height at world (x,z)
+  float getHeight(float x, float z) const;
+
+  // Batched queries over count points passed as separate x and z arrays. Results match
+  // getHeight; gradients are the exact derivatives dh/dx, dh/dz of the interpolated surface.
+  void sampleHeights(const float *x, const float *z, int count, float *outHeight) const;
+  void sampleHeightsAndGradients(const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz) const;
+
+  // Slope (dh/dx, dh/dz) at world (x,z), blended from the stored per-vertex slopes of the
+  // four surrounding grid points. Constant time; Profile computes it from the batch path.
+  glm::vec2 getSlope(float x, float z) const;
+
+  // First point where the ray origin + t * dir (dir need not be normalized) meets the
+  // interpolated surface, for t in [0, maxDist] world units along dir. Skips whole tiles of the
+  // min/max pyramid the ray passes above and solves each remaining cell exactly. A ray
+  // starting below the surface hits at its entry into the window.
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &dir, float maxDist, float &outDist) const;
+
+  // Lowest and highest vertex height over columns [firstCol, lastCol) and logical rows [firstRow, lastRow)
+  void getHeightRange(int firstCol, int lastCol, int firstRow, int lastRow, float &minY, float &maxY) const;
+
+  // Build the vertices of one logical row (positions, normals from the vertex slopes, texcoords)
+  void buildRowVertices(int logicalRow, TerrainVertex *out) const;
+
+  // Ring buffer mapping. Logical row 0 is the -Z edge of the window; physical rows wrap at depth.
+  int physicalRow(int logicalRow) const { return (ringStart + logicalRow) % depth; }
+
+  int getWidth() const { return width; }
+  int getDepth() const { return depth; }
+  float getScale() const { return scale; }
+  float getOffsetX() const { return offsetX; }
+  float getOffsetZ() const { return offsetZ; }
+  int getRingStart() const { return ringStart; }
+  int smoothHalo() const { return SMOOTH_ITERATIONS * smoothRadius; }
+  // Global index of logical row 0 (counts whole rows from the origin along Z)
+  int getRowOrigin() const { return rowOrigin; }
+  // Smoothed heights of a physical row (row 'depth' is the mirror of row 0), or null unless Grid
+  const float *rowData(int physicalRow) const { return heights.empty() ? nullptr : &heights[physicalRow * width]; }
+  // World Z of the window's first and last rows
+  float getMinZ() const { return (0 - depth / 2) * scale + offsetZ; }
+  float getMaxZ() const { return (depth - 1 - depth / 2) * scale + offsetZ; }
+  // World X of the window's first and last columns
+  float getMinX() const { return (0 - width / 2) * scale + offsetX; }
+  float getMaxX() const { return (width - 1 - width / 2) * scale + offsetX; }
+  bool contains(float x, float z) const { return x >= getMinX() && x <= getMaxX() && z >= getMinZ() && z <= getMaxZ(); }
+  // Lowest and highest height in the window, from the top of the min/max pyramid
+  void getHeightBounds(float &minY, float &maxY) const;
+  // Bytes held by the height, slope and profile arrays (not the scratch buffers)
+  size_t getStorageBytes() const;
+
+private:
+  void sampleRows(int firstRow, int lastRow);
+  // Re-smooth logical rows [firstRow, lastRow) from the raw samples
+  void smoothRows(int firstRow, int lastRow);
+  void smoothProfile(int firstRow, int lastRow);
+  // Unsmoothed heights of a logical row; rebuilt from the row noise when they are not stored
+  void rawRow(int logicalRow, float *out) const;
+  // Add one edit's offsets to the raw heights of a logical row
+  void addEdit(const Edit &edit, int logicalRow, float *out) const;
+  // Store smoothed logical rows [firstRow, lastRow), whole blocks for Quantized, from a band starting at bandFirst
+  void storeRows(int firstRow, int lastRow, const std::vector<float> &band, int bandFirst);
+  float decodeHeight(int physicalRow, int ix) const
+  {
+    const glm::vec2 &q = blockQuant[physicalRow / QUANT_BLOCK * blockCols + ix / QUANT_BLOCK];
+    return q.x + q.y * quantHeights[physicalRow * width + ix];
+  }
+  // Recompute the stored slopes of logical rows [firstRow, lastRow) from the smoothed heights
+  void updateSlopes(int firstRow, int lastRow);
+  // Recompute the pyramid tiles that touch logical rows [firstRow, lastRow)
+  void updatePyramid(int firstRow, int lastRow);
+  // Exact first hit inside one cell along a ray segment of length len; see raycast
+  bool raycastCell(int ix, int logicalRow, const glm::vec3 &p, const glm::vec3 &dir, float len, float &outDist) const;
+  // Smoothed height at a grid point of the window (logical row), in either representation
+  float heightAt(int ix, int logicalRow) const;
+  // Central-difference slope at a grid point (one-sided on the window edge)
+  glm::vec2 slopeAt(int ix, int logicalRow) const;
+  // Shared body of the batched queries; gradients are skipped when outDx/outDz are null
+  void sampleBatch(const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz) const;
+  // Bilinear part of sampleBatch; fetch(physicalRow, ix) reads one stored height
+  template <class Fetch>
+  void sampleGrid(Fetch fetch, const float *x, const float *z, int count, float *outHeight, float *outDx, float *outDz) const;
+  float detailAt(float wx, float wz) const { return lateralDetail ? lateralDetail(wx, wz) : 0.0f; }
+
+  int width = 0;
+  int depth = 0;
+  float scale = 1.0f;
+  float heightScale = 1.0f;
+  float difficultyMultiplier = 1.0f; // Increases terrain steepness over distance
+  unsigned int terrainSeed = 0;      // Seed for procedural terrain generation
+  NoiseParams noiseParams;           // Terms of the noise pattern selected by terrainSeed
+
+  // Offset for infinite terrain generation
+  float offsetX = 0.0f;
+  float offsetZ = 0.0f;
+
+  // Height rows are stored as a ring buffer so streaming along Z only touches new rows.
+  // Both grids hold depth+1 rows: row 'depth' mirrors row 0 so every logically adjacent
+  // pair of rows is also adjacent in memory (and in the vertex buffer).
+  std::vector<float> heights;    // smoothed heights, size width*(depth+1); empty for Profile
+  std::vector<float> rawHeights; // unsmoothed samples, same layout; Grid only
+  std::vector<uint16_t> quantHeights; // smoothed heights as codes, size width*depth (no mirrored row); Quantized only
+  std::vector<glm::vec2> blockQuant;  // (min, step) per QUANT_BLOCK square, by physical block row * blockCols; Quantized only
+  int blockCols = 0;
+  std::vector<float> profile;    // smoothed per-row heights, size depth+1; Profile only
+  std::vector<float> rawProfile; // unsmoothed noise per row, size depth+1; both representations
+  std::vector<int16_t> slopes;   // (dh/dx, dh/dz) / SLOPE_STEP per vertex, size 2*width*(depth+1); empty for Profile
+  std::vector<Edit> edits;       // oldest first
+
+  // Min/max pyramid for raycasts. Tiles are aligned to global rows (rowOrigin + logical row),
+  // so streaming only recomputes the tiles at the window ends; tile row t of a level lives in
+  // slot t mod rows. Each tile holds the height range of the vertices it covers in the window.
+  struct PyramidLevel
+  {
+    int size = 0; // cells per side
+    int cols = 0;
+    int rows = 0; // slots in the tile row ring
+    std::vector<glm::vec2> bounds;
+  };
+  std::vector<PyramidLevel> pyramid;
+  int ringStart = 0;             // physical row holding logical row 0
+  int rowOrigin = 0;             // global row index of logical row 0
+
+  Representation representation = Representation::Grid;
+  LateralDetail lateralDetail;
+  int smoothRadius = SMOOTH_RADIUS;
+
+  // Working buffers reused between calls. They are not part of the grid's contents, so
+  // copying a grid (front to back every job) leaves the copy's scratch empty; moves keep it.
+  struct Scratch
+  {
+    std::vector<float> sampleZ;   // batched noise input/output
+    std::vector<float> sampleOut;
+    std::vector<float> bandA;     // smoothing ping-pong buffers
+    std::vector<float> bandB;
+    std::vector<double> rowSums;  // horizontal box sums of the band
+    std::vector<double> colSums;  // running vertical sums, one per column
+
+    Scratch() = default;
+    Scratch(const Scratch &) {}
+    Scratch &operator=(const Scratch &) { return *this; }
+    Scratch(Scratch &&) = default;
+    Scratch &operator=(Scratch &&) = default;
+  };
+  Scratch scratch;
+};
@@ -0,0 +1,305 @@
+#include "TerrainMesh.h"
+#include <learnopengl/entity.h>
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+
+TerrainMesh::TerrainMesh() {}
+TerrainMesh::~TerrainMesh() { cleanup(); }
+
+void TerrainMesh::cleanup()
+{
+  if (EBO)
+  {
+    glDeleteBuffers(1, &EBO);
+    EBO = 0;
+    stats.glObjectsLive--;
+  }
+  if (VBO)
+  {
+    glDeleteBuffers(1, &VBO);
+    VBO = 0;
+    stats.glObjectsLive--;
+  }
+  if (VAO)
+  {
+    glDeleteVertexArrays(1, &VAO);
+    VAO = 0;
+    stats.glObjectsLive--;
+  }
+  meshWidth = 0;
+  meshDepth = 0;
+}
+
+void TerrainMesh::update(Terrain &terrain)
+{
+  if (!terrain.takeVertexUpdate(pending))
+    return;
+
+  const int width = pending.width;
+  const int depth = pending.depth;
+  size_t offset = 0;
+  size_t firstRun = 0;
+  if (pending.reset)
+  {
+    // The first run holds the whole mesh, mirrored row included
+    uploadAll(width, depth, pending.vertices.data());
+    offset = static_cast<size_t>(width) * (depth + 1);
+    firstRun = 1;
+  }
+  if (!VBO || width != meshWidth || depth != meshDepth)
+    return;
+
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  for (size_t i = firstRun; i < pending.runs.size(); ++i)
+  {
+    const Terrain::VertexRun &run = pending.runs[i];
+    const TerrainVertex *data = &pending.vertices[offset];
+    const GLsizeiptr rowBytes = run.cols * sizeof(TerrainVertex);
+    // Full rows are contiguous in the buffer; narrower runs are uploaded row by row
+    if (run.cols == width)
+    {
+      uploadVertices(run.row * width * sizeof(TerrainVertex), run.rows * rowBytes, data);
+    }
+    else
+    {
+      for (int r = 0; r < run.rows; ++r)
+        uploadVertices(((run.row + r) * width + run.firstCol) * sizeof(TerrainVertex), rowBytes, data + r * run.cols);
+    }
+    // Physical row 0 is mirrored after the last row
+    if (run.row == 0)
+      uploadVertices((depth * width + run.firstCol) * sizeof(TerrainVertex), rowBytes, data);
+    offset += run.rows * run.cols;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TerrainMesh::uploadVertices(GLintptr offset, GLsizeiptr size, const void *data)
+{
+  glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+  stats.bytesUploaded += size;
+}
+
+void TerrainMesh::uploadAll(int width, int depth, const TerrainVertex *vertices)
+{
+  const GLsizeiptr bytes = static_cast<GLsizeiptr>(width) * (depth + 1) * sizeof(TerrainVertex);
+
+  // The VAO and buffers are created once and reused by every later init() of the terrain
+  bool created = false;
+  if (!VAO)
+  {
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    stats.glObjectsCreated += 3;
+    stats.glObjectsLive += 3;
+    created = true;
+  }
+
+  glBindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+  if (width == meshWidth && depth == meshDepth)
+  {
+    // Same layout: refill the existing storage, the index buffer is still valid
+    uploadVertices(0, bytes, vertices);
+  }
+  else
+  {
+    glBufferData(GL_ARRAY_BUFFER, bytes, vertices, GL_DYNAMIC_DRAW);
+    stats.bufferAllocations++;
+
+    std::vector<unsigned int> indices;
+    buildChunkIndices(width, indices);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    stats.bufferAllocations++;
+
+    meshWidth = width;
+    meshDepth = depth;
+  }
+
+  if (created)
+  {
+    // position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex), (void *)offsetof(TerrainVertex, px));
+    glEnableVertexAttribArray(0);
+    // normal
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex), (void *)offsetof(TerrainVertex, nx));
+    glEnableVertexAttribArray(1);
+    // texcoord
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex), (void *)offsetof(TerrainVertex, u));
+    glEnableVertexAttribArray(2);
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TerrainMesh::buildChunkIndices(int width, std::vector<unsigned int> &indices)
+{
+  const int CHUNK_SIZE = Terrain::CHUNK_SIZE;
+  // Index templates for one chunk, relative to its first vertex (drawn with a base vertex).
+  // Level k uses every 2^k-th vertex. On an edge next to a coarser chunk, odd vertices snap to
+  // the previous even one so the edge matches the neighbour's and no cracks open up.
+  for (int level = 0; level < LOD_LEVELS; ++level)
+  {
+    const int step = 1 << level;
+    for (int mask = 0; mask < EDGE_MASKS; ++mask)
+    {
+      // Neighbours are never coarser than the coarsest level
+      if (level == LOD_LEVELS - 1 && mask != 0)
+      {
+        chunkIndexRanges[level][mask] = chunkIndexRanges[level][0];
+        continue;
+      }
+
+      auto vertex = [&](int lx, int lz) -> unsigned int
+      {
+        if (((mask & EDGE_NEG_Z) && lz == 0) || ((mask & EDGE_POS_Z) && lz == CHUNK_SIZE))
+          lx -= (lx / step) % 2 * step;
+        if (((mask & EDGE_NEG_X) && lx == 0) || ((mask & EDGE_POS_X) && lx == CHUNK_SIZE))
+          lz -= (lz / step) % 2 * step;
+        return lz * width + lx;
+      };
+      auto triangle = [&indices](unsigned int a, unsigned int b, unsigned int c)
+      {
+        // Snapping collapses some triangles; leave those out
+        if (a == b || b == c || a == c)
+          return;
+        indices.push_back(a);
+        indices.push_back(b);
+        indices.push_back(c);
+      };
+
+      IndexRange &range = chunkIndexRanges[level][mask];
+      range.first = static_cast<GLsizei>(indices.size());
+      for (int lz = 0; lz < CHUNK_SIZE; lz += step)
+      {
+        for (int lx = 0; lx < CHUNK_SIZE; lx += step)
+        {
+          unsigned int a = vertex(lx, lz);
+          unsigned int b = vertex(lx + step, lz);
+          unsigned int c = vertex(lx + step, lz + step);
+          unsigned int d = vertex(lx, lz + step);
+          // two triangles: a,b,c and a,c,d
+          triangle(a, b, c);
+          triangle(a, c, d);
+        }
+      }
+      range.count = static_cast<GLsizei>(indices.size()) - range.first;
+    }
+  }
+}
+
+void TerrainMesh::render(const Terrain &terrain, const glm::vec3 &viewPos, float viewDistance, const Frustum *frustum)
+{
+  stats.chunksDrawn = 0;
+  stats.chunksTotal = 0;
+  stats.indicesDrawn = 0;
+  const TerrainGrid &grid = terrain.getGrid();
+  // Skip frames where the terrain was re-initialized but its vertices are not uploaded yet
+  if (!VAO || grid.getWidth() != meshWidth || grid.getDepth() != meshDepth)
+    return;
+
+  const int CHUNK_SIZE = Terrain::CHUNK_SIZE;
+  const std::vector<glm::vec2> &chunkHeights = terrain.getChunkHeights();
+  const int width = grid.getWidth();
+  const int depth = grid.getDepth();
+  const float scale = grid.getScale();
+  const float chunkExtent = CHUNK_SIZE * scale;
+  const int chunksX = (width - 1) / CHUNK_SIZE;
+  // The last logical chunk row ends on the mirrored first row (it would join the far edge
+  // of the window to the near one), so it is never drawn
+  const int chunksZ = depth / CHUNK_SIZE - 1;
+
+  // LOD from the distance between the viewer and the nearest point of each chunk. Chunks out
+  // of view still get a level so their neighbours stitch consistently.
+  chunkLods.assign(chunksX * chunksZ, 0);
+  chunkInView.assign(chunksX * chunksZ, 0);
+  for (int cz = 0; cz < chunksZ; ++cz)
+  {
+    float z0 = (cz * CHUNK_SIZE - depth / 2) * scale + grid.getOffsetZ();
+    float dz = std::max(std::max(z0 - viewPos.z, viewPos.z - (z0 + chunkExtent)), 0.0f);
+    const glm::vec2 *heights = &chunkHeights[grid.physicalRow(cz * CHUNK_SIZE) / CHUNK_SIZE * chunksX];
+    for (int cx = 0; cx < chunksX; ++cx)
+    {
+      float x0 = (cx * CHUNK_SIZE - width / 2) * scale + grid.getOffsetX();
+      float dx = std::max(std::max(x0 - viewPos.x, viewPos.x - (x0 + chunkExtent)), 0.0f);
+      float dist = std::sqrt(dx * dx + dz * dz);
+
+      int level = 0;
+      while (level < LOD_LEVELS - 1 && dist >= LOD_DISTANCE_FACTOR * chunkExtent * (1 << level))
+        level++;
+      chunkLods[cz * chunksX + cx] = level;
+
+      bool inView = dist <= viewDistance;
+      if (inView && frustum)
+      {
+        AABB box(glm::vec3(x0, heights[cx].x, z0), glm::vec3(x0 + chunkExtent, heights[cx].y, z0 + chunkExtent));
+        inView = box.isOnFrustum(*frustum);
+      }
+      chunkInView[cz * chunksX + cx] = inView;
+    }
+  }
+  stats.chunksTotal = chunksX * chunksZ;
+
+  // Stitching only covers a one level step, so limit neighbouring chunks to that
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (int cz = 0; cz < chunksZ; ++cz)
+    {
+      for (int cx = 0; cx < chunksX; ++cx)
+      {
+        int &level = chunkLods[cz * chunksX + cx];
+        int limit = level;
+        if (cx > 0)
+          limit = std::min(limit, chunkLods[cz * chunksX + cx - 1] + 1);
+        if (cx < chunksX - 1)
+          limit = std::min(limit, chunkLods[cz * chunksX + cx + 1] + 1);
+        if (cz > 0)
+          limit = std::min(limit, chunkLods[(cz - 1) * chunksX + cx] + 1);
+        if (cz < chunksZ - 1)
+          limit = std::min(limit, chunkLods[(cz + 1) * chunksX + cx] + 1);
+        if (limit < level)
+        {
+          level = limit;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  glBindVertexArray(VAO);
+  for (int cz = 0; cz < chunksZ; ++cz)
+  {
+    // Chunk rows start on a multiple of CHUNK_SIZE in the ring, so their rows are contiguous
+    const GLint rowBase = grid.physicalRow(cz * CHUNK_SIZE) * width;
+    for (int cx = 0; cx < chunksX; ++cx)
+    {
+      if (!chunkInView[cz * chunksX + cx])
+        continue;
+
+      const int level = chunkLods[cz * chunksX + cx];
+      int mask = 0;
+      if (cx > 0 && chunkLods[cz * chunksX + cx - 1] > level)
+        mask |= EDGE_NEG_X;
+      if (cx < chunksX - 1 && chunkLods[cz * chunksX + cx + 1] > level)
+        mask |= EDGE_POS_X;
+      if (cz > 0 && chunkLods[(cz - 1) * chunksX + cx] > level)
+        mask |= EDGE_NEG_Z;
+      if (cz < chunksZ - 1 && chunkLods[(cz + 1) * chunksX + cx] > level)
+        mask |= EDGE_POS_Z;
+
+      const IndexRange &range = chunkIndexRanges[level][mask];
+      glDrawElementsBaseVertex(GL_TRIANGLES, range.count, GL_UNSIGNED_INT,
+                               (void *)(sizeof(unsigned int) * range.first), rowBase + cx * CHUNK_SIZE);
+      stats.chunksDrawn++;
+      stats.indicesDrawn += range.count;
+    }
+  }
+  glBindVertexArray(0);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Terrain.h"
+
+struct Frustum;
+
+// GL resource and draw counters for the terrain mesh
+struct TerrainMeshStats
+{
+  // Kept across cleanup() so leaks show up as a growing glObjectsLive
+  int glObjectsCreated = 0;     // VAOs and buffers generated
+  int glObjectsLive = 0;        // generated minus deleted
+  int bufferAllocations = 0;    // glBufferData calls (storage (re)specified)
+  size_t bytesUploaded = 0;     // bytes sent with glBufferSubData
+
+  // Last render() call
+  int chunksDrawn = 0;  // chunks within the view distance and inside the frustum
+  int chunksTotal = 0;  // drawable chunks in the window
+  int indicesDrawn = 0;
+};
+
+// Chunked LOD mesh of a Terrain's render grid. Terrain itself holds no GL state; this mirrors
+// its vertex updates into a vertex buffer laid out in ring order.
+class TerrainMesh
+{
+public:
+  TerrainMesh();
+  ~TerrainMesh();
+
+  // Number of LOD levels (vertex steps 1, 2, 4, 8, 16)
+  static constexpr int LOD_LEVELS = 5;
+  // A chunk drops to LOD level k once it is further than LOD_DISTANCE_FACTOR * chunk size * 2^k from the viewer
+  static constexpr float LOD_DISTANCE_FACTOR = 1.5f;
+
+  // Upload the vertices the terrain changed since the last call. The terrain needs
+  // setVertexOutput(true) before its init().
+  void update(Terrain &terrain);
+
+  // Render terrain (uses currently bound shader; shader must accept 'model').
+  // Only chunks within viewDistance of viewPos (and inside frustum, when given) are drawn,
+  // with LOD chosen by distance.
+  void render(const Terrain &terrain, const glm::vec3 &viewPos, float viewDistance, const Frustum *frustum = nullptr);
+
+  void cleanup();
+
+  const TerrainMeshStats &getStats() const { return stats; }
+
+private:
+  void buildChunkIndices(int width, std::vector<unsigned int> &indices);
+  // Respecify storage (and the index buffer) when the grid size changed, then fill it
+  void uploadAll(int width, int depth, const TerrainVertex *vertices);
+  void uploadVertices(GLintptr offset, GLsizeiptr size, const void *data);
+
+  GLuint VAO = 0;
+  GLuint VBO = 0;
+  GLuint EBO = 0;
+
+  // Edges of a chunk whose neighbour uses the next coarser LOD
+  enum EdgeMask
+  {
+    EDGE_NEG_X = 1,
+    EDGE_POS_X = 2,
+    EDGE_NEG_Z = 4,
+    EDGE_POS_Z = 8,
+    EDGE_MASKS = 16
+  };
+  // Range of one chunk index template in the index buffer
+  struct IndexRange
+  {
+    GLsizei first = 0;
+    GLsizei count = 0;
+  };
+  IndexRange chunkIndexRanges[LOD_LEVELS][EDGE_MASKS];
+  // Per drawable chunk in logical order, rebuilt every render()
+  std::vector<int> chunkLods;
+  std::vector<char> chunkInView;
+  // Grid size the buffer storage was specified for; the index buffer only depends on this
+  int meshWidth = 0;
+  int meshDepth = 0;
+  Terrain::VertexUpdate pending;
+  TerrainMeshStats stats;
+};
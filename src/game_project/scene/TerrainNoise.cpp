@@ -0,0 +1,372 @@
+#include "TerrainNoise.h"
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_NOISE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TERRAIN_NOISE_NEON
+#endif
+
+NoiseParams NoiseParams::fromSeed(unsigned int seed)
+{
+  // Use seed to create unique phase offsets and select equation pattern
+  NoiseParams p;
+  p.pattern = seed % PATTERN_COUNT;
+  p.seedOffset[0] = (seed % 1000) * 0.01f;
+  p.seedOffset[1] = ((seed / 1000) % 1000) * 0.01f;
+  p.seedOffset[2] = ((seed / 1000000) % 1000) * 0.01f;
+  p.seedOffset[3] = ((seed / 1000000000) % 1000) * 0.01f;
+  return p;
+}
+
+float sampleNoiseReference(float z, unsigned int seed)
+{
+  // Use seed to create unique phase offsets and select equation pattern
+  float seedOffset1 = (seed % 1000) * 0.01f;
+  float seedOffset2 = ((seed / 1000) % 1000) * 0.01f;
+  float seedOffset3 = ((seed / 1000000) % 1000) * 0.01f;
+  float seedOffset4 = ((seed / 1000000000) % 1000) * 0.01f;
+
+  // Select terrain pattern based on seed
+  int pattern = seed % 8;
+
+  float v = 0.0f;
+
+  switch (pattern)
+  {
+  case 0: // Classic rolling hills
+    v += 1.0f * std::sin(z * 0.05f + seedOffset1);
+    v += 0.5f * std::sin(z * 0.12f + seedOffset2);
+    v += 0.25f * std::sin(z * 0.23f + seedOffset3);
+    v += 0.125f * std::sin(z * 0.41f + seedOffset4);
+    break;
+
+  case 1: // Sharp ridges
+    v += 1.2f * std::sin(z * 0.08f + seedOffset2);
+    v += 0.6f * std::cos(z * 0.15f + seedOffset4);
+    v += 0.3f * std::sin(z * 0.25f + seedOffset1);
+    v += 0.15f * std::cos(z * 0.35f + seedOffset2);
+    break;
+
+  case 2: // Wavy dunes
+    v += 1.0f * std::sin(z * 0.06f + seedOffset1);
+    v += 0.8f * std::cos(z * 0.04f + seedOffset2);
+    v += 0.4f * std::sin(z * 0.1f + seedOffset3);
+    v += 0.2f * std::cos(z * 0.12f + seedOffset4);
+    break;
+
+  case 3: // Gentle waves
+    v += 1.0f * std::sin(z * 0.07f + seedOffset1);
+    v += 0.5f * std::sin(z * 0.15f + seedOffset3);
+    v += 0.25f * std::sin(z * 0.18f + seedOffset2);
+    break;
+
+  case 4: // Steep hills
+  {
+    v += 1.0f * std::sin(z * 0.05f + seedOffset1);
+    v += 0.5f * std::cos(z * 0.1f + seedOffset2);
+    v += 0.3f * std::sin(z * 0.2f + seedOffset3);
+    v += 0.2f * std::cos(z * 0.3f + seedOffset1);
+    break;
+  }
+
+  case 5: // Complex fractal-like
+    v += 1.0f * std::sin(z * 0.04f + seedOffset1);
+    v += 0.6f * std::cos(z * 0.09f + seedOffset4);
+    v += 0.35f * std::sin(z * 0.19f + seedOffset2);
+    v += 0.2f * std::cos(z * 0.33f + seedOffset4);
+    v += 0.1f * std::sin(z * 0.48f + seedOffset2);
+    break;
+
+  case 6: // Turbulent mix
+    v += 1.1f * (std::sin(z * 0.06f + seedOffset1) + std::cos(z * 0.05f + seedOffset2)) * 0.5f;
+    v += 0.55f * (std::sin(z * 0.13f + seedOffset3) + std::sin(z * 0.11f + seedOffset4)) * 0.5f;
+    v += 0.3f * std::sin(z * 0.18f + seedOffset1);
+    v += 0.15f * std::cos(z * 0.31f + seedOffset4);
+    break;
+
+  case 7: // Mountain peaks
+    v += 1.3f * std::sin(z * 0.04f + seedOffset2);
+    v += 0.7f * std::sin(z * 0.07f + seedOffset4);
+    v += 0.4f * std::cos(z * 0.14f + seedOffset2);
+    v += 0.2f * std::cos(z * 0.27f + seedOffset4);
+    v += 0.1f * std::sin(z * 0.35f + seedOffset1);
+    break;
+  }
+
+  return v;
+}
+
+namespace
+{
+  // Cody-Waite split of pi/2: k * DP1 is exact for |k| < 2^16
+  constexpr float TWO_OVER_PI = 0.636619772367581343f;
+  constexpr float DP1 = 1.5703125f;
+  constexpr float DP2 = 4.837512969970703125e-4f;
+  constexpr float DP3 = 7.54978995489188216e-8f;
+  // Minimax sin/cos polynomials on [-pi/4, pi/4] (Cephes sinf/cosf)
+  constexpr float S1 = -1.6666654611e-1f;
+  constexpr float S2 = 8.3321608736e-3f;
+  constexpr float S3 = -1.9515295891e-4f;
+  constexpr float C1 = 4.166664568298827e-2f;
+  constexpr float C2 = -1.388731625493765e-3f;
+  constexpr float C3 = 2.443315711809948e-5f;
+
+  struct ScalarOps
+  {
+    static constexpr int WIDTH = 1;
+    using F = float;
+    using I = int32_t;
+    static F load(const float *p) { return *p; }
+    static void store(float *p, F v) { *p = v; }
+    static F set(float v) { return v; }
+    static I setInt(int v) { return v; }
+    static F add(F a, F b) { return a + b; }
+    static F sub(F a, F b) { return a - b; }
+    static F mul(F a, F b) { return a * b; }
+    static I roundToInt(F v) { return static_cast<I>(std::lrint(v)); }
+    static F toFloat(I v) { return static_cast<float>(v); }
+    static I addInt(I a, I b) { return a + b; }
+    // q & 1 ? odd : even
+    static F selectOdd(I q, F odd, F even) { return (q & 1) ? odd : even; }
+    // q & 2 ? -v : v
+    static F negateIfBit1(I q, F v) { return (q & 2) ? -v : v; }
+  };
+
+#if defined(__AVX2__)
+  struct Avx2Ops
+  {
+    static constexpr int WIDTH = 8;
+    using F = __m256;
+    using I = __m256i;
+    static F load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, F v) { _mm256_storeu_ps(p, v); }
+    static F set(float v) { return _mm256_set1_ps(v); }
+    static I setInt(int v) { return _mm256_set1_epi32(v); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static I roundToInt(F v) { return _mm256_cvtps_epi32(v); }
+    static F toFloat(I v) { return _mm256_cvtepi32_ps(v); }
+    static I addInt(I a, I b) { return _mm256_add_epi32(a, b); }
+    static F selectOdd(I q, F odd, F even)
+    {
+      I one = _mm256_set1_epi32(1);
+      F mask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+      return _mm256_blendv_ps(even, odd, mask);
+    }
+    static F negateIfBit1(I q, F v)
+    {
+      I sign = _mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30);
+      return _mm256_xor_ps(v, _mm256_castsi256_ps(sign));
+    }
+  };
+  using BatchOps = Avx2Ops;
+#elif defined(TERRAIN_NOISE_SSE2)
+  struct Sse2Ops
+  {
+    static constexpr int WIDTH = 4;
+    using F = __m128;
+    using I = __m128i;
+    static F load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, F v) { _mm_storeu_ps(p, v); }
+    static F set(float v) { return _mm_set1_ps(v); }
+    static I setInt(int v) { return _mm_set1_epi32(v); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static I roundToInt(F v) { return _mm_cvtps_epi32(v); }
+    static F toFloat(I v) { return _mm_cvtepi32_ps(v); }
+    static I addInt(I a, I b) { return _mm_add_epi32(a, b); }
+    static F selectOdd(I q, F odd, F even)
+    {
+      I one = _mm_set1_epi32(1);
+      F mask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+      return _mm_or_ps(_mm_and_ps(mask, odd), _mm_andnot_ps(mask, even));
+    }
+    static F negateIfBit1(I q, F v)
+    {
+      I sign = _mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30);
+      return _mm_xor_ps(v, _mm_castsi128_ps(sign));
+    }
+  };
+  using BatchOps = Sse2Ops;
+#elif defined(TERRAIN_NOISE_NEON)
+  struct NeonOps
+  {
+    static constexpr int WIDTH = 4;
+    using F = float32x4_t;
+    using I = int32x4_t;
+    static F load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, F v) { vst1q_f32(p, v); }
+    static F set(float v) { return vdupq_n_f32(v); }
+    static I setInt(int v) { return vdupq_n_s32(v); }
+    static F add(F a, F b) { return vaddq_f32(a, b); }
+    static F sub(F a, F b) { return vsubq_f32(a, b); }
+    static F mul(F a, F b) { return vmulq_f32(a, b); }
+    static I roundToInt(F v) { return vcvtnq_s32_f32(v); }
+    static F toFloat(I v) { return vcvtq_f32_s32(v); }
+    static I addInt(I a, I b) { return vaddq_s32(a, b); }
+    static F selectOdd(I q, F odd, F even)
+    {
+      I one = vdupq_n_s32(1);
+      return vbslq_f32(vceqq_s32(vandq_s32(q, one), one), odd, even);
+    }
+    static F negateIfBit1(I q, F v)
+    {
+      I sign = vshlq_n_s32(vandq_s32(q, vdupq_n_s32(2)), 30);
+      return vreinterpretq_f32_s32(veorq_s32(vreinterpretq_s32_f32(v), sign));
+    }
+  };
+  using BatchOps = NeonOps;
+#else
+  using BatchOps = ScalarOps;
+#endif
+
+  // One sin/cos term of a pattern: amp * sin(z * freq + seedOffset[offset]), cos when cosine is set
+  struct PatternTerm
+  {
+    float amp;
+    float freq;
+    int offset;
+    bool cosine;
+  };
+
+  // Same patterns as sampleNoiseReference, one term per sin/cos call
+  template <int P>
+  struct Pattern;
+
+  template <>
+  struct Pattern<0> // Classic rolling hills
+  {
+    static constexpr PatternTerm terms[] = {
+        {1.0f, 0.05f, 0, false}, {0.5f, 0.12f, 1, false}, {0.25f, 0.23f, 2, false}, {0.125f, 0.41f, 3, false}};
+  };
+  template <>
+  struct Pattern<1> // Sharp ridges
+  {
+    static constexpr PatternTerm terms[] = {
+        {1.2f, 0.08f, 1, false}, {0.6f, 0.15f, 3, true}, {0.3f, 0.25f, 0, false}, {0.15f, 0.35f, 1, true}};
+  };
+  template <>
+  struct Pattern<2> // Wavy dunes
+  {
+    static constexpr PatternTerm terms[] = {
+        {1.0f, 0.06f, 0, false}, {0.8f, 0.04f, 1, true}, {0.4f, 0.1f, 2, false}, {0.2f, 0.12f, 3, true}};
+  };
+  template <>
+  struct Pattern<3> // Gentle waves
+  {
+    static constexpr PatternTerm terms[] = {
+        {1.0f, 0.07f, 0, false}, {0.5f, 0.15f, 2, false}, {0.25f, 0.18f, 1, false}};
+  };
+  template <>
+  struct Pattern<4> // Steep hills
+  {
+    static constexpr PatternTerm terms[] = {
+        {1.0f, 0.05f, 0, false}, {0.5f, 0.1f, 1, true}, {0.3f, 0.2f, 2, false}, {0.2f, 0.3f, 0, true}};
+  };
+  template <>
+  struct Pattern<5> // Complex fractal-like
+  {
+    static constexpr PatternTerm terms[] = {
+        {1.0f, 0.04f, 0, false}, {0.6f, 0.09f, 3, true}, {0.35f, 0.19f, 1, false}, {0.2f, 0.33f, 3, true}, {0.1f, 0.48f, 1, false}};
+  };
+  template <>
+  struct Pattern<6> // Turbulent mix (the averaged pairs become half-amplitude terms)
+  {
+    static constexpr PatternTerm terms[] = {
+        {0.55f, 0.06f, 0, false}, {0.55f, 0.05f, 1, true}, {0.275f, 0.13f, 2, false},
+        {0.275f, 0.11f, 3, false}, {0.3f, 0.18f, 0, false}, {0.15f, 0.31f, 3, true}};
+  };
+  template <>
+  struct Pattern<7> // Mountain peaks
+  {
+    static constexpr PatternTerm terms[] = {
+        {1.3f, 0.04f, 1, false}, {0.7f, 0.07f, 3, false}, {0.4f, 0.14f, 1, true}, {0.2f, 0.27f, 3, true}, {0.1f, 0.35f, 0, false}};
+  };
+
+  // amp * sin(x) (or cos) with x = z * freq + phase. Declared inline so GCC expands it into
+  // every kernel instead of sharing one out-of-line copy with the constants passed in registers
+  template <class V, bool Cosine>
+  inline typename V::F evalTerm(typename V::F zv, typename V::F freq, typename V::F phase, typename V::F amp)
+  {
+    using F = typename V::F;
+    using I = typename V::I;
+    F x = V::add(V::mul(zv, freq), phase);
+
+    // Reduce to r in [-pi/4, pi/4] and quadrant k
+    I k = V::roundToInt(V::mul(x, V::set(TWO_OVER_PI)));
+    F kf = V::toFloat(k);
+    F r = V::sub(V::sub(V::sub(x, V::mul(kf, V::set(DP1))), V::mul(kf, V::set(DP2))), V::mul(kf, V::set(DP3)));
+    F r2 = V::mul(r, r);
+
+    F s = V::add(r, V::mul(V::mul(r, r2), V::add(V::set(S1), V::mul(r2, V::add(V::set(S2), V::mul(r2, V::set(S3)))))));
+    F c = V::add(V::sub(V::set(1.0f), V::mul(V::set(0.5f), r2)),
+                 V::mul(V::mul(r2, r2), V::add(V::set(C1), V::mul(r2, V::add(V::set(C2), V::mul(r2, V::set(C3)))))));
+
+    // cos(x) = sin(x + pi/2): shift the quadrant by one for cosine terms
+    I q = Cosine ? V::addInt(k, V::setInt(1)) : k;
+    return V::mul(amp, V::negateIfBit1(q, V::selectOdd(q, c, s)));
+  }
+
+  // Sum of all terms of pattern P, unrolled at compile time
+  template <class V, int P, int... T>
+  inline typename V::F sumTerms(typename V::F zv, const typename V::F *phase, std::integer_sequence<int, T...>)
+  {
+    constexpr const PatternTerm *terms = Pattern<P>::terms;
+    typename V::F acc = V::set(0.0f);
+    ((acc = V::add(acc, evalTerm<V, terms[T].cosine>(zv, V::set(terms[T].freq), phase[T], V::set(terms[T].amp)))), ...);
+    return acc;
+  }
+
+  // Evaluates count samples of pattern P; count must be a multiple of V::WIDTH
+  template <class V, int P>
+  void noiseKernel(const NoiseParams &p, const float *z, int count, float *out)
+  {
+    constexpr int N = static_cast<int>(std::size(Pattern<P>::terms));
+    typename V::F phase[N];
+    for (int t = 0; t < N; ++t)
+      phase[t] = V::set(p.seedOffset[Pattern<P>::terms[t].offset]);
+    for (int i = 0; i < count; i += V::WIDTH)
+      V::store(out + i, sumTerms<V, P>(V::load(z + i), phase, std::make_integer_sequence<int, N>{}));
+  }
+
+  using KernelFn = void (*)(const NoiseParams &, const float *, int, float *);
+
+  template <int... P>
+  constexpr std::array<KernelFn, sizeof...(P)> makeKernelTable(std::integer_sequence<int, P...>)
+  {
+    return {{&noiseKernel<BatchOps, P>...}};
+  }
+  constexpr auto KERNELS = makeKernelTable(std::make_integer_sequence<int, NoiseParams::PATTERN_COUNT>{});
+}
+
+void sampleNoiseBatch(const NoiseParams &params, const float *z, int count, float *out)
+{
+  // Pick the pattern's kernel once per call; the loops inside have no per-sample branches
+  KernelFn kernel = KERNELS[params.pattern];
+  constexpr int W = BatchOps::WIDTH;
+  int body = count - count % W;
+  kernel(params, z, body, out);
+
+  // Run the tail through the same vector code so results never depend on batch boundaries
+  if (body < count)
+  {
+    float zTail[W];
+    float outTail[W];
+    for (int i = 0; i < W; ++i)
+      zTail[i] = z[std::min(body + i, count - 1)];
+    kernel(params, zTail, W, outTail);
+    std::copy(outTail, outTail + (count - body), out + body);
+  }
+}
@@ -15,7 +15,7 @@
 Scene::Scene() {}
 Scene::~Scene() { cleanup(); }
 
-bool Scene::init(int scrWidth, int scrHeight, unsigned int terrainSeed)
+bool Scene::init(int scrWidth, int scrHeight)
 {
   // ground geometry
   float groundVertices[] = {
@@ -162,14 +162,13 @@ bool Scene::init(int scrWidth, int scrHeight, unsigned int terrainSeed)
 
   std::cerr << "Scene::init: models loaded = " << models.size() << std::endl;
 
+  // Model space bounds for frustum culling, computed once per model
+  modelBounds.clear();
+  for (const auto &m : models)
+    modelBounds.push_back(generateAABB(m));
+
   // Create circular platform
   createCircularPlatform();
-
-  // initialize procedural terrain (width, depth, scale, heightScale, seed)
-  if (!terrain.init(160, 1600, 1.0f, 3.5f, terrainSeed))
-  {
-    std::cerr << "Scene::init: terrain initialization failed" << std::endl;
-  }
   return true;
 }
 
@@ -431,7 +430,7 @@ bool Scene::showGameOver(GLFWwindow *window, Shader &shader, GameUI &gameUI, int
   return !glfwWindowShouldClose(window);
 }
 
-void Scene::renderScene(Shader &shader, Camera &camera, Car &car, int selectedIndex, int scrWidth, int scrHeight)
+void Scene::renderScene(Shader &shader, Camera &camera, const Car &car, Terrain &terrain, int selectedIndex, int scrWidth, int scrHeight)
 {
   // Render sky background first
   glDisable(GL_DEPTH_TEST);
@@ -447,24 +446,40 @@ void Scene::renderScene(Shader &shader, Camera &camera, Car &car, int selectedIn
   glEnable(GL_DEPTH_TEST);
 
   shader.use();
-  glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)scrWidth / (float)scrHeight, 0.1f, 100.0f);
+  const float nearPlane = 0.1f;
+  const float farPlane = 100.0f;
+  const float aspect = (float)scrWidth / (float)scrHeight;
+  glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspect, nearPlane, farPlane);
   glm::mat4 view = camera.GetViewMatrix();
   shader.setMat4("projection", projection);
   shader.setMat4("view", view);
 
+  // Built once per frame and shared by every culling test (also used by CollectibleRenderer::draw)
+  frustum = createFrustumFromCamera(camera, aspect, glm::radians(camera.Zoom), nearPlane, farPlane);
+
   glm::mat4 model = car.getModelMatrix();
   model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-  shader.setMat4("model", model);
-  models[selectedIndex].Draw(shader);
+  Transform carTransform;
+  carTransform.computeModelMatrix(model);
+  cullStats.carsTotal = 1;
+  cullStats.carsVisible = 0;
+  if (modelBounds[selectedIndex].isOnFrustum(frustum, carTransform))
+  {
+    shader.setMat4("model", model);
+    models[selectedIndex].Draw(shader);
+    cullStats.carsVisible = 1;
+  }
 
   glm::mat4 groundModel = glm::mat4(1.0f);
   shader.setMat4("model", groundModel);
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, groundTexture);
-  // Update terrain for infinite generation
-  terrain.update(car.position.x, car.position.z);
-  // render procedural terrain in-game
-  terrain.render();
+  // Upload the rows the terrain streamed in since the last frame, then render it
+  terrainMesh.update(terrain);
+  terrain.setViewDistance(farPlane);
+  terrainMesh.render(terrain, camera.Position, farPlane, &frustum);
+  cullStats.chunksVisible = terrainMesh.getStats().chunksDrawn;
+  cullStats.chunksTotal = terrainMesh.getStats().chunksTotal;
 }
 
 void Scene::createCircularPlatform()
@@ -561,5 +576,39 @@ void Scene::cleanup()
     glDeleteBuffers(1, &platformVBO);
   if (platformEBO)
     glDeleteBuffers(1, &platformEBO);
-  terrain.cleanup();
+  terrainMesh.cleanup();
+}
+
+void Scene::updateCamera(const Car &car, Camera &cam)
+{
+  // Position camera to the right side of the car, slightly behind, and above
+  const float SIDE_DIST = 15.0f;  // how far to the right of the car
+  const float BACK_OFFSET = 1.0f; // small offset behind the car
+  const float HEIGHT = 7.5f;      // camera height above car position
+  const float PITCH_DEG = -20.0f; // desired camera pitch in degrees
+
+  // Follow the interpolated car, so the camera moves as smoothly as the car is drawn
+  float yawRad = glm::radians(car.renderYaw);
+  glm::vec3 forwardVec = glm::vec3(cos(yawRad), 0.0f, sin(yawRad));
+  // right vector from forward and world-up
+  glm::vec3 rightVec = glm::vec3(-forwardVec.z, 0.0f, forwardVec.x);
+
+  glm::vec3 desiredCamPos = car.renderPosition + rightVec * SIDE_DIST - forwardVec * BACK_OFFSET + glm::vec3(0.0f, HEIGHT, 0.0f);
+  cam.Position = desiredCamPos;
+
+  // Compute horizontal yaw to look roughly toward the car, but enforce the requested pitch
+  float lookX = car.renderPosition.x - cam.Position.x;
+  float lookZ = car.renderPosition.z - cam.Position.z;
+  float yawDeg = glm::degrees(std::atan2(lookZ, lookX));
+  cam.Yaw = yawDeg;
+  cam.Pitch = PITCH_DEG;
+
+  // Recompute Front/Right/Up using the camera's Euler angles (same math as Camera::updateCameraVectors)
+  glm::vec3 front;
+  front.x = cos(glm::radians(cam.Yaw)) * cos(glm::radians(cam.Pitch));
+  front.y = sin(glm::radians(cam.Pitch));
+  front.z = sin(glm::radians(cam.Yaw)) * cos(glm::radians(cam.Pitch));
+  cam.Front = glm::normalize(front);
+  cam.Right = glm::normalize(glm::cross(cam.Front, cam.WorldUp));
+  cam.Up = glm::normalize(glm::cross(cam.Right, cam.Front));
 }
@@ -11,11 +11,22 @@
 #include "../core/controls.h"
 #include "../core/car.h"
 #include <learnopengl/camera.h>
+#include <learnopengl/entity.h>
 #include "Terrain.h"
+#include "TerrainMesh.h"
 
 // Forward declaration
 class GameUI;
 
+// Visible/total counts from the last renderScene culling pass
+struct CullStats
+{
+  int carsVisible = 0;
+  int carsTotal = 0;
+  int chunksVisible = 0;
+  int chunksTotal = 0;
+};
+
 struct ModelInfo
 {
   std::string path;
@@ -27,20 +38,25 @@ public:
   Scene();
   ~Scene();
 
-  bool init(int scrWidth, int scrHeight, unsigned int terrainSeed = 12345);
+  bool init(int scrWidth, int scrHeight);
 
   bool showMenu(GLFWwindow *window, Shader &shader, GameUI &gameUI, Controls &controls, int &selectedIndex, int scrWidth, int scrHeight);
 
   bool showGameOver(GLFWwindow *window, Shader &shader, GameUI &gameUI, int finalScore, int scrWidth, int scrHeight);
 
-  void renderScene(Shader &shader, Camera &camera, Car &car, int selectedIndex, int scrWidth, int scrHeight);
+  // Draws the car and the terrain; vertices the terrain changed since the last frame are uploaded first
+  void renderScene(Shader &shader, Camera &camera, const Car &car, Terrain &terrain, int selectedIndex, int scrWidth, int scrHeight);
+
+  // Place the camera beside and above the car, looking at it
+  static void updateCamera(const Car &car, Camera &cam);
 
   void cleanup();
   
   void createCircularPlatform();
 
-  // Access the scene's terrain for physics sampling
-  Terrain &getTerrain() { return terrain; }
+  // Camera frustum of the last renderScene call, for culling other draws in the same frame
+  const Frustum &getFrustum() const { return frustum; }
+  const CullStats &getCullStats() const { return cullStats; }
 
 private:
   unsigned int groundVAO = 0;
@@ -60,6 +76,10 @@ private:
   std::vector<ModelInfo> modelInfos;
   std::vector<std::string> modelPaths;
   std::vector<Model> models;
+  std::vector<AABB> modelBounds;
+
+  Frustum frustum;
+  CullStats cullStats;
 
-  Terrain terrain;
+  TerrainMesh terrainMesh;
 };
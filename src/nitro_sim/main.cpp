@@ -0,0 +1,420 @@
+// Headless NitroClimb simulation: runs the game rules, physics and terrain streaming with
+// scripted controls and reports how fast it ticks. Needs no display or GL.
+//
+//   nitro_sim_cli [--seconds N] [--seed S] [--tick-rate HZ] [--envs N] [--threads T] [--async-terrain] [--verbose]
+//                 [--record FILE]
+//   nitro_sim_cli --replay FILE
+//   nitro_sim_cli --soak N
+//   nitro_sim_cli --rewind SECONDS [--seconds N] [--seed S] [--tick-rate HZ]
+//   nitro_sim_cli --check
+//   nitro_sim_cli --bench
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../game_project/core/sim_batch.h"
+#include "../game_project/core/controls_log.h"
+#include "../game_project/physics/physics.h"
+#include "sim_checks.h"
+#include "terrain_checks.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <fstream>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+namespace
+{
+  struct Options
+  {
+    float seconds = 60.0f;
+    unsigned int seed = 12345;
+    float tickRate = 120.0f;
+    int envs = 1;
+    int threads = 1;
+    bool asyncTerrain = false;
+    bool verbose = false;
+    std::string recordPath;
+    std::string replayPath;
+    int soakRounds = 0;
+    float rewindSeconds = 0.0f;
+    bool check = false;
+    bool bench = false;
+  };
+
+  void printUsage()
+  {
+    std::cout << "usage: nitro_sim_cli [--seconds N] [--seed S] [--tick-rate HZ] [--envs N] [--threads T] [--async-terrain] [--verbose]\n"
+              << "  --seconds N      simulated seconds to run (default 60)\n"
+              << "  --seed S         terrain seed of the first game (default 12345)\n"
+              << "  --tick-rate HZ   fixed simulation ticks per second (default 120)\n"
+              << "  --envs N         independent games stepped together (default 1)\n"
+              << "  --threads T      threads stepping them, 0 = one per core (default 1)\n"
+              << "  --async-terrain  build terrain windows on a worker thread per game instead of inline\n"
+              << "  --verbose        print pickups as they happen\n"
+              << "  --record FILE    write the controls of environment 0's first game to FILE\n"
+              << "  --replay FILE    replay a recorded game as fast as possible and check its result\n"
+              << "  --soak N         restart N games, one simulated second each, and report restart time and memory\n"
+              << "  --rewind S       snapshot every tick into a ring of S seconds and report snapshot and rewind costs\n"
+              << "  --check          check the terrain fast paths against their references, the car's wheels and landings, and rewinding\n"
+              << "  --bench          time the terrain fast paths" << std::endl;
+  }
+
+  // Full throttle, weaving left and right every few seconds, with a burst of boost every ten.
+  // Each game runs the script from its own start.
+  Controls scriptedControls(float t)
+  {
+    Controls c;
+    c.throttle = true;
+    const float phase = std::fmod(t, 8.0f);
+    if (phase >= 2.0f && phase < 3.0f)
+      c.steer = 1;
+    else if (phase >= 6.0f && phase < 7.0f)
+      c.steer = -1;
+    c.boost = std::fmod(t, 10.0f) >= 9.0f;
+    return c;
+  }
+
+  bool parseOptions(int argc, char **argv, Options &options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      const char *arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (std::strcmp(arg, "--seconds") == 0 && hasValue)
+        options.seconds = std::strtof(argv[++i], nullptr);
+      else if (std::strcmp(arg, "--seed") == 0 && hasValue)
+        options.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+      else if (std::strcmp(arg, "--tick-rate") == 0 && hasValue)
+        options.tickRate = std::strtof(argv[++i], nullptr);
+      else if (std::strcmp(arg, "--envs") == 0 && hasValue)
+        options.envs = std::atoi(argv[++i]);
+      else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+        options.threads = std::atoi(argv[++i]);
+      else if (std::strcmp(arg, "--async-terrain") == 0)
+        options.asyncTerrain = true;
+      else if (std::strcmp(arg, "--verbose") == 0)
+        options.verbose = true;
+      else if (std::strcmp(arg, "--record") == 0 && hasValue)
+        options.recordPath = argv[++i];
+      else if (std::strcmp(arg, "--replay") == 0 && hasValue)
+        options.replayPath = argv[++i];
+      else if (std::strcmp(arg, "--soak") == 0 && hasValue)
+        options.soakRounds = std::atoi(argv[++i]);
+      else if (std::strcmp(arg, "--rewind") == 0 && hasValue)
+        options.rewindSeconds = static_cast<float>(std::atof(argv[++i]));
+      else if (std::strcmp(arg, "--check") == 0)
+        options.check = true;
+      else if (std::strcmp(arg, "--bench") == 0)
+        options.bench = true;
+      else
+        return false;
+    }
+    // Recording needs the terrain built in step with the ticks
+    if (!options.recordPath.empty() && options.asyncTerrain)
+      return false;
+    return options.seconds > 0.0f && options.tickRate > 0.0f && options.envs > 0 && options.threads >= 0 && options.soakRounds >= 0 &&
+           options.rewindSeconds >= 0.0f;
+  }
+
+  // Resident memory of this process in bytes, 0 where unsupported
+  size_t residentBytes()
+  {
+#if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+      return 0;
+    return info.resident_size;
+#else
+    return 0;
+#endif
+  }
+
+  // Restart the same session over and over: memory should stay flat once the pools and
+  // terrain windows have their size
+  int soak(const Options &options)
+  {
+    const float dt = 1.0f / options.tickRate;
+    const int ticksPerRound = static_cast<int>(options.tickRate + 0.5f);
+
+    // Physics alone: reset the world and put a new car in it
+    PhysicsWorld world;
+    Car car;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < options.soakRounds; ++round)
+    {
+      world.reset();
+      car = Car();
+      Physics::initializeCar(car, world, car.position);
+      world.stepSimulation(dt);
+    }
+    const double physicsSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Whole games: terrain, physics and collectibles
+    GameSession session;
+    session.setDeterministic(true);
+    // The terrain alternates between windows, so the second start still allocates; measure
+    // growth from a few rounds in
+    const int warmupRounds = std::min(options.soakRounds, 4);
+    size_t warmBytes = 0;
+    size_t peakBytes = 0;
+    double startSeconds = 0.0;
+    for (int round = 0; round < options.soakRounds; ++round)
+    {
+      auto roundStart = std::chrono::steady_clock::now();
+      if (!session.start(options.seed + round))
+        return 1;
+      startSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - roundStart).count();
+      for (int tick = 0; tick < ticksPerRound && !session.isGameOver(); ++tick)
+        session.tick(dt, scriptedControls(session.getTime()));
+
+      const size_t bytes = residentBytes();
+      if (round == warmupRounds - 1)
+        warmBytes = bytes;
+      peakBytes = std::max(peakBytes, bytes);
+    }
+    const size_t lastBytes = residentBytes();
+
+    const double rounds = options.soakRounds;
+    std::cout << "rounds:           " << options.soakRounds << "\n"
+              << "physics reset:    " << (rounds > 0 ? physicsSeconds / rounds * 1e6 : 0.0) << " us per reset + car + step\n"
+              << "game start:       " << (rounds > 0 ? startSeconds / rounds * 1e3 : 0.0) << " ms per start()\n"
+              << "resident memory:  " << warmBytes / 1024 << " KB after round " << warmupRounds << ", "
+              << lastBytes / 1024 << " KB after the last, peak " << peakBytes / 1024 << " KB" << std::endl;
+    return 0;
+  }
+
+  // Play one deterministic game twice, without and with a snapshot every tick, then rewind one
+  // tick at a time through the whole ring and play the rewound stretch again
+  int rewind(const Options &options)
+  {
+    const float dt = 1.0f / options.tickRate;
+    const long totalTicks = static_cast<long>(options.seconds * options.tickRate + 0.5f);
+    const int capacity = std::max(1, static_cast<int>(options.rewindSeconds * options.tickRate + 0.5f));
+
+    double tickSeconds[2] = {0.0, 0.0};
+    GameSession session;
+    session.setDeterministic(true);
+    std::vector<Controls> controls;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      if (!session.start(options.seed))
+        return 1;
+      session.setRewindCapacity(pass == 0 ? 0 : capacity);
+      controls.clear();
+      auto start = std::chrono::steady_clock::now();
+      for (long tick = 0; tick < totalTicks && !session.isGameOver(); ++tick)
+      {
+        controls.push_back(scriptedControls(session.getTime()));
+        session.tick(dt, controls.back());
+      }
+      tickSeconds[pass] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    const uint32_t lastTick = session.getTick();
+    const uint32_t oldestTick = session.getOldestRewindTick();
+    const glm::vec3 endPosition = session.getCar().position;
+    const int endScore = session.getScore();
+
+    double restoreTotal = 0.0;
+    double restoreMax = 0.0;
+    for (uint32_t tick = lastTick; tick-- > oldestTick;)
+    {
+      auto start = std::chrono::steady_clock::now();
+      if (!session.rewindTo(tick))
+        return 1;
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      restoreTotal += seconds;
+      restoreMax = std::max(restoreMax, seconds);
+    }
+    const uint32_t restores = lastTick - oldestTick;
+
+    // Contacts are dropped on rewind and the terrain keeps its craters, so a replay after a
+    // rewind can drift from the first run
+    for (uint32_t tick = oldestTick; tick < lastTick; ++tick)
+      session.tick(dt, controls[tick]);
+    const float drift = glm::length(session.getCar().position - endPosition);
+
+    const double ticks = static_cast<double>(lastTick);
+    std::cout << "ticks:            " << lastTick << " at " << options.tickRate << " Hz, ring of " << capacity << " snapshots ("
+              << session.getRewindBytes() / 1024 << " KB)\n"
+              << "tick:             " << (ticks > 0 ? tickSeconds[0] / ticks * 1e6 : 0.0) << " us without snapshots, "
+              << (ticks > 0 ? tickSeconds[1] / ticks * 1e6 : 0.0) << " us with\n"
+              << "rewind:           " << restores << " steps back to tick " << oldestTick << ", "
+              << (restores > 0 ? restoreTotal / restores * 1e6 : 0.0) << " us mean, " << restoreMax * 1e6 << " us max\n"
+              << "replayed:         score " << session.getScore() << " (first run " << endScore << "), end position " << drift << " m apart" << std::endl;
+    return 0;
+  }
+
+  // Every check runs even after one fails, so the report is complete
+  int check()
+  {
+    bool ok = checkNoiseBatch();
+    ok = checkSmoothing() && ok;
+    ok = checkQuantized() && ok;
+    ok = checkRaycast() && ok;
+    ok = checkWheelContact() && ok;
+    ok = checkHardLanding() && ok;
+    ok = checkRewind() && ok;
+    return ok ? 0 : 3;
+  }
+
+  ControlsLog::Result resultOf(GameSession &session, uint32_t ticks)
+  {
+    ControlsLog::Result result;
+    result.ticks = ticks;
+    result.score = session.getScore();
+    result.x = session.getCar().position.x;
+    result.y = session.getCar().position.y;
+    result.z = session.getCar().position.z;
+    return result;
+  }
+
+  // Run a recorded game in a fresh session and compare where it ends, bit for bit
+  int replay(const Options &options)
+  {
+    ControlsLog log;
+    if (!log.load(options.replayPath))
+      return 1;
+
+    GameSession session;
+    session.setDeterministic(true);
+    session.setLogEvents(options.verbose);
+    if (!session.start(log.getSeed()))
+      return 1;
+
+    const float dt = 1.0f / log.getTickRate();
+    auto start = std::chrono::steady_clock::now();
+    for (const ControlsLog::Run &run : log.getRuns())
+    {
+      const Controls controls = ControlsLog::unpack(run.controls);
+      for (uint32_t i = 0; i < run.ticks; ++i)
+        session.tick(dt, controls);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    const ControlsLog::Result expected = log.getResult();
+    const ControlsLog::Result actual = resultOf(session, log.getTickCount());
+    const bool match = expected.ticks == actual.ticks && expected.score == actual.score &&
+                       std::memcmp(&expected.x, &actual.x, sizeof(float)) == 0 &&
+                       std::memcmp(&expected.y, &actual.y, sizeof(float)) == 0 &&
+                       std::memcmp(&expected.z, &actual.z, sizeof(float)) == 0;
+    const double wallSeconds = std::chrono::duration<double>(end - start).count();
+    std::cout.precision(9);
+    std::cout << "replayed:         " << actual.ticks << " ticks in " << log.getRuns().size() << " runs, seed " << log.getSeed() << "\n"
+              << "wall time:        " << wallSeconds << " s\n"
+              << "ticks per second: " << (wallSeconds > 0.0 ? actual.ticks / wallSeconds : 0.0) << "\n"
+              << "recorded:         score " << expected.score << " at (" << expected.x << ", " << expected.y << ", " << expected.z << ")\n"
+              << "replay:           score " << actual.score << " at (" << actual.x << ", " << actual.y << ", " << actual.z << ")\n"
+              << (match ? "result matches" : "RESULT DIFFERS") << std::endl;
+    return match ? 0 : 3;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    printUsage();
+    return 2;
+  }
+  if (!options.replayPath.empty())
+    return replay(options);
+  if (options.soakRounds > 0)
+    return soak(options);
+  if (options.rewindSeconds > 0.0f)
+    return rewind(options);
+  if (options.check)
+    return check();
+  if (options.bench)
+  {
+    benchNoise();
+    benchRaycast();
+    return 0;
+  }
+
+  SimBatch batch(options.threads);
+  if (!batch.reset(options.envs, options.seed, options.asyncTerrain))
+    return 1;
+  for (int env = 0; env < batch.size(); ++env)
+    batch.getSession(env).setLogEvents(options.verbose);
+
+  const float dt = 1.0f / options.tickRate;
+  const long totalTicks = static_cast<long>(options.seconds * options.tickRate + 0.5f);
+  // Seeds after the initial ones go to games restarted when they run out of fuel
+  unsigned int nextSeed = options.seed + options.envs;
+  int games = options.envs;
+  int score = 0;
+  float distance = 0.0f;
+  std::vector<Controls> controls(options.envs);
+  ControlsLog log;
+  bool recording = !options.recordPath.empty();
+  log.begin(options.seed, options.tickRate);
+
+  // Timed from the first tick; restarted games include their start() in the time
+  auto start = std::chrono::steady_clock::now();
+  for (long tick = 0; tick < totalTicks; ++tick)
+  {
+    for (int env = 0; env < batch.size(); ++env)
+    {
+      GameSession &session = batch.getSession(env);
+      if (batch.getObservations().gameOver[env])
+      {
+        if (env == 0 && recording)
+        {
+          log.setResult(resultOf(session, log.getTickCount()));
+          recording = false;
+        }
+        score += session.getScore();
+        distance += session.getDistanceTraveled();
+        if (!batch.restart(env, nextSeed++))
+          return 1;
+        games++;
+      }
+      controls[env] = scriptedControls(session.getTime());
+    }
+    if (recording)
+      log.record(controls[0]);
+    batch.step(dt, controls.data());
+  }
+  auto end = std::chrono::steady_clock::now();
+  for (int env = 0; env < batch.size(); ++env)
+  {
+    score += batch.getSession(env).getScore();
+    distance += batch.getSession(env).getDistanceTraveled();
+  }
+
+  if (recording)
+    log.setResult(resultOf(batch.getSession(0), log.getTickCount()));
+  if (!options.recordPath.empty())
+  {
+    if (!log.save(options.recordPath))
+      return 1;
+    std::cout << "recorded:         " << log.getTickCount() << " ticks in " << log.getRuns().size() << " runs to " << options.recordPath << std::endl;
+  }
+
+  const double wallSeconds = std::chrono::duration<double>(end - start).count();
+  const double envTicks = static_cast<double>(totalTicks) * options.envs;
+  std::cout << "environments:     " << options.envs << " on " << batch.getThreadCount() << " threads\n"
+            << "ticks:            " << totalTicks << " per environment at " << options.tickRate << " Hz (" << options.seconds << " s simulated)\n"
+            << "wall time:        " << wallSeconds << " s\n"
+            << "ticks per second: " << (wallSeconds > 0.0 ? envTicks / wallSeconds : 0.0) << " (all environments)\n"
+            << "realtime factor:  " << (wallSeconds > 0.0 ? options.seconds / wallSeconds : 0.0) << "x per environment\n"
+            << "games:            " << games << " (score " << score << ", distance " << distance << " m)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,145 @@
+#include "sim_checks.h"
+#include <algorithm>
+#include <iostream>
+
+#include "../game_project/core/game_session.h"
+#include "../game_project/physics/physics.h"
+#include "../game_project/scene/Terrain.h"
+
+namespace
+{
+  const float TICK = 1.0f / 120.0f;
+
+  // Terrain with a height scale of 0: flat at height 0, built inline so edits apply at once
+  bool initFlatTerrain(Terrain &terrain)
+  {
+    terrain.setAsyncGeneration(false);
+    return terrain.init(128, 256, 2.0f, 0.0f, 1u);
+  }
+
+  // Tick the car with no controls, the terrain following it as in GameSession::tick
+  void runTicks(Car &car, PhysicsWorld &world, Terrain &terrain, int ticks)
+  {
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+      car.beginTick();
+      Physics::updateCar(car, TICK, Controls(), world, &terrain);
+      terrain.update(car.position.x, car.position.z);
+    }
+  }
+
+  // Full throttle, steering one way then the other every two seconds
+  Controls rewindControls(uint32_t tick)
+  {
+    Controls c;
+    c.throttle = true;
+    c.steer = (tick / 240) % 2 == 0 ? 1 : -1;
+    return c;
+  }
+
+  bool sameState(const GameSession &a, const GameSession &b)
+  {
+    const Car &carA = a.getCar();
+    const Car &carB = b.getCar();
+    return a.getTick() == b.getTick() && a.getTime() == b.getTime() && a.getScore() == b.getScore() &&
+           carA.position == carB.position && carA.yaw == carB.yaw && carA.fuel == carB.fuel && carA.turbo == carB.turbo &&
+           a.getCollectibles().totalCount() == b.getCollectibles().totalCount() &&
+           a.getCollectibles().remaining() == b.getCollectibles().remaining();
+  }
+}
+
+bool checkWheelContact()
+{
+  Terrain terrain;
+  if (!initFlatTerrain(terrain))
+    return false;
+  PhysicsWorld world;
+  Car car;
+  Physics::initializeCar(car, world, glm::vec3(0.0f, terrain.getHeight(0.0f, 0.0f), 0.0f));
+  runTicks(car, world, terrain, 240);
+
+  // Forces the wheels add on top of whatever the last tick left on the body
+  PhysicsWorld::BodyState before;
+  PhysicsWorld::BodyState after;
+  PhysicsWorld::saveBody(car.rigidBody, before);
+  Car *cars[1] = {&car};
+  Physics::applyWheelForces(cars, 1, TICK, terrain);
+  PhysicsWorld::saveBody(car.rigidBody, after);
+  const float upForce = after.force[1] - before.force[1];
+  const int craters = terrain.getStats().editsApplied;
+
+  const bool ok = car.wheelsInContact == 4 && upForce > 0.0f && craters == 0;
+  std::cout << "wheel contact:    " << car.wheelsInContact << " of 4 wheels at rest, " << upForce << " N up, ride height "
+            << car.position.y - terrain.getHeight(car.position.x, car.position.z) << " m, " << craters << " craters"
+            << (ok ? "" : "  FAILED") << std::endl;
+  return ok;
+}
+
+bool checkHardLanding()
+{
+  Terrain terrain;
+  if (!initFlatTerrain(terrain))
+    return false;
+  const float ground = terrain.getHeight(0.0f, 0.0f);
+  PhysicsWorld world;
+  Car car;
+  // initializeCar starts the body 2 m above the given point
+  Physics::initializeCar(car, world, glm::vec3(0.0f, ground + 8.0f, 0.0f));
+
+  // Fall until the first crater, which must come after a fall with no wheel on the ground
+  float fallSpeed = 0.0f;
+  int airborneTicks = 0;
+  PhysicsWorld::BodyState body;
+  for (int tick = 0; tick < 360 && terrain.getStats().editsApplied == 0; ++tick)
+  {
+    PhysicsWorld::saveBody(car.rigidBody, body);
+    fallSpeed = std::max(fallSpeed, -body.linearVelocity[1]);
+    runTicks(car, world, terrain, 1);
+    if (car.wheelsInContact == 0)
+      airborneTicks++;
+  }
+  const int craters = terrain.getStats().editsApplied;
+  const float depth = ground - terrain.getHeight(car.position.x, car.position.z);
+
+  const bool ok = craters > 0 && airborneTicks > 0 && depth > 0.0f;
+  std::cout << "hard landing:     " << (craters > 0 ? "crater " : "no crater ") << depth << " m deep after " << airborneTicks
+            << " airborne ticks, landing at " << fallSpeed << " m/s" << (ok ? "" : "  FAILED") << std::endl;
+  return ok;
+}
+
+bool checkRewind()
+{
+  const unsigned int SEED = 777u;
+  const uint32_t CAPACITY = 600;
+  const uint32_t LAST_TICK = 1000;
+  const uint32_t FIRST_REWIND = 900;
+
+  GameSession session;
+  session.setDeterministic(true);
+  if (!session.start(SEED))
+    return false;
+  session.setRewindCapacity(CAPACITY);
+  for (uint32_t tick = 0; tick < LAST_TICK; ++tick)
+    session.tick(TICK, rewindControls(tick));
+
+  // Tick LAST_TICK took the slot of LAST_TICK - CAPACITY, so the second rewind can reach back
+  // only to the tick after that
+  const bool firstOk = session.rewindTo(FIRST_REWIND);
+  const uint32_t oldest = session.getOldestRewindTick();
+  const bool refused = !session.rewindTo(LAST_TICK - CAPACITY);
+  const bool secondOk = session.rewindTo(oldest);
+
+  GameSession fresh;
+  fresh.setDeterministic(true);
+  if (!fresh.start(SEED))
+    return false;
+  for (uint32_t tick = 0; tick < oldest; ++tick)
+    fresh.tick(TICK, rewindControls(tick));
+  const bool matches = secondOk && sameState(session, fresh);
+
+  const bool ok = firstOk && oldest == LAST_TICK - CAPACITY + 1 && refused && matches;
+  std::cout << "rewind:           " << LAST_TICK << " -> " << FIRST_REWIND << " -> " << oldest << " with a ring of " << CAPACITY
+            << ", tick " << LAST_TICK - CAPACITY << (refused ? " refused" : " accepted") << ", "
+            << (matches ? "matches a fresh run" : "differs from a fresh run") << (ok ? "" : "  FAILED") << std::endl;
+  return ok;
+}
@@ -0,0 +1,18 @@
+#ifndef NITRO_SIM_SIM_CHECKS_H
+#define NITRO_SIM_SIM_CHECKS_H
+
+// Checks of the car physics on flat terrain and of GameSession's rewind ring, run by
+// nitro_sim_cli --check next to the terrain checks. Each prints one line with what it saw and
+// returns false on a failure.
+
+// A car settled on flat ground: Physics::applyWheelForces finds all four wheels in contact and
+// pushes the body up, and settling left no crater
+bool checkWheelContact();
+// A car dropped onto flat ground falls with no wheel in contact, then its hard landing deforms
+// the terrain under it
+bool checkHardLanding();
+// Rewind a game, then rewind it again further back: ticks whose ring slots already hold later
+// ticks are refused, and the oldest one still reachable matches a fresh run
+bool checkRewind();
+
+#endif
@@ -0,0 +1,566 @@
+#include "terrain_checks.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "../game_project/scene/TerrainGrid.h"
+#include "../game_project/scene/TerrainNoise.h"
+
+namespace
+{
+  bool report(const char *name, double error, double bound)
+  {
+    const bool ok = error <= bound;
+    std::cout << name << "max error " << error << " (bound " << bound << ")" << (ok ? "" : "  FAILED") << std::endl;
+    return ok;
+  }
+
+  // Best of a few timed runs of fn, in seconds
+  template <class Fn>
+  double bestTime(Fn fn, int runs = 5)
+  {
+    double best = 1e30;
+    for (int run = 0; run < runs; ++run)
+    {
+      auto start = std::chrono::steady_clock::now();
+      fn();
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+  }
+
+  // Height added across each row, so the blur has something to do along X as well
+  float lateralDetail(float x, float z)
+  {
+    return 0.3f * std::sin(x * 0.37f) * std::cos(z * 0.11f) + 0.05f * std::sin(x * 2.3f + z);
+  }
+
+  // The window's raw samples, logical row by row, as TerrainGrid::sampleRows computes them
+  std::vector<float> rawWindow(const TerrainGrid &grid, unsigned int seed, float heightScale)
+  {
+    const int width = grid.getWidth();
+    const int depth = grid.getDepth();
+    std::vector<float> z(depth);
+    std::vector<float> noise(depth);
+    for (int iz = 0; iz < depth; ++iz)
+      z[iz] = (iz - depth / 2) * grid.getScale() + grid.getOffsetZ();
+    sampleNoiseBatch(NoiseParams::fromSeed(seed), z.data(), depth, noise.data());
+
+    std::vector<float> raw(width * depth);
+    for (int iz = 0; iz < depth; ++iz)
+      for (int ix = 0; ix < width; ++ix)
+        raw[iz * width + ix] = noise[iz] * heightScale + lateralDetail((ix - width / 2) * grid.getScale() + grid.getOffsetX(), z[iz]);
+    return raw;
+  }
+
+  struct Ray
+  {
+    glm::vec3 origin;
+    glm::vec3 dir; // unit length
+    float maxDist;
+  };
+
+  // A streamed Grid window with lateral detail and a few craters, as a raycast target
+  void buildRaycastGrid(TerrainGrid &grid, std::mt19937 &rng)
+  {
+    grid.setLateralDetail(lateralDetail);
+    grid.init(129, 400, 2.0f, 3.5f, 31337u);
+    TerrainGrid::RowRanges dirty;
+    grid.streamRows(-48, dirty);
+    grid.streamRows(96, dirty);
+    for (int i = 0; i < 12; ++i)
+    {
+      TerrainGrid::Edit edit;
+      edit.x = std::uniform_real_distribution<float>(grid.getMinX(), grid.getMaxX())(rng);
+      edit.z = std::uniform_real_distribution<float>(grid.getMinZ(), grid.getMaxZ())(rng);
+      edit.radius = std::uniform_real_distribution<float>(3.0f, 12.0f)(rng);
+      edit.depth = std::uniform_real_distribution<float>(-1.5f, 1.5f)(rng);
+      TerrainGrid::CellRect changed;
+      grid.deform(edit, changed);
+    }
+  }
+
+  // Rays from above the ground, mostly inside the window, looking down to slightly up, so
+  // some hit close, some far and some miss
+  std::vector<Ray> randomRays(const TerrainGrid &grid, std::mt19937 &rng, int count)
+  {
+    std::uniform_real_distribution<float> px(grid.getMinX() - 20.0f, grid.getMaxX() + 20.0f);
+    std::uniform_real_distribution<float> pz(grid.getMinZ() - 20.0f, grid.getMaxZ() + 20.0f);
+    std::uniform_real_distribution<float> height(0.2f, 25.0f);
+    std::uniform_real_distribution<float> heading(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> pitch(-0.8f, 0.1f);
+    std::uniform_real_distribution<float> reach(5.0f, 400.0f);
+    std::vector<Ray> rays(count);
+    for (Ray &ray : rays)
+    {
+      const float x = px(rng);
+      const float z = pz(rng);
+      ray.origin = glm::vec3(x, grid.getHeight(x, z) + height(rng), z);
+      const float a = heading(rng);
+      const float p = pitch(rng);
+      ray.dir = glm::vec3(std::cos(a) * std::cos(p), std::sin(p), std::sin(a) * std::cos(p));
+      ray.maxDist = reach(rng);
+    }
+    return rays;
+  }
+
+  // March getHeight in steps of 'step' over the part of the ray inside the window, then bisect
+  // the first step that ends below the surface. A ray entering the window below the surface
+  // hits at the entry, as with raycast. minClearance is the lowest height of the sampled ray
+  // above the ground.
+  bool marchRay(const TerrainGrid &grid, const Ray &ray, float step, float &outDist, float &minClearance)
+  {
+    minClearance = std::numeric_limits<float>::max();
+    float tEnter = 0.0f;
+    float tLeave = ray.maxDist;
+    const float lo[2] = {grid.getMinX(), grid.getMinZ()};
+    const float hi[2] = {grid.getMaxX(), grid.getMaxZ()};
+    const float p[2] = {ray.origin.x, ray.origin.z};
+    const float d[2] = {ray.dir.x, ray.dir.z};
+    for (int axis = 0; axis < 2; ++axis)
+    {
+      if (d[axis] == 0.0f)
+      {
+        if (p[axis] < lo[axis] || p[axis] > hi[axis])
+          return false;
+        continue;
+      }
+      float t0 = (lo[axis] - p[axis]) / d[axis];
+      float t1 = (hi[axis] - p[axis]) / d[axis];
+      tEnter = std::max(tEnter, std::min(t0, t1));
+      tLeave = std::min(tLeave, std::max(t0, t1));
+    }
+
+    float previous = tEnter;
+    for (int i = 0;; ++i)
+    {
+      const float t = std::min(tEnter + i * step, tLeave);
+      if (t < tEnter)
+        return false;
+      const glm::vec3 q = ray.origin + ray.dir * t;
+      const float clearance = q.y - grid.getHeight(q.x, q.z);
+      minClearance = std::min(minClearance, clearance);
+      if (clearance <= 0.0f)
+      {
+        float below = t;
+        float above = previous;
+        for (int k = 0; k < 30 && i > 0; ++k)
+        {
+          const float mid = 0.5f * (above + below);
+          const glm::vec3 m = ray.origin + ray.dir * mid;
+          (m.y - grid.getHeight(m.x, m.z) <= 0.0f ? below : above) = mid;
+        }
+        outDist = below;
+        return true;
+      }
+      if (t >= tLeave)
+        return false;
+      previous = t;
+    }
+  }
+
+  // The blur TerrainGrid replaced: every pass sums the (2r+1)^2 neighbours of each interior
+  // cell directly; cells within r of the window edge keep their raw height
+  void directBlur(std::vector<float> &heights, int width, int depth, int radius, int iterations)
+  {
+    std::vector<float> smoothed = heights;
+    const int count = (2 * radius + 1) * (2 * radius + 1);
+    for (int iter = 0; iter < iterations; ++iter)
+    {
+      for (int iz = radius; iz < depth - radius; ++iz)
+      {
+        for (int ix = radius; ix < width - radius; ++ix)
+        {
+          float sum = 0.0f;
+          for (int dz = -radius; dz <= radius; ++dz)
+            for (int dx = -radius; dx <= radius; ++dx)
+              sum += heights[(iz + dz) * width + (ix + dx)];
+          smoothed[iz * width + ix] = sum / count;
+        }
+      }
+      heights = smoothed;
+    }
+  }
+
+  // Largest difference between the grid's stored heights and the direct blur of its window
+  double smoothingError(const TerrainGrid &grid, unsigned int seed, float heightScale, int radius, bool &mirrorOk)
+  {
+    const int width = grid.getWidth();
+    const int depth = grid.getDepth();
+    std::vector<float> expected = rawWindow(grid, seed, heightScale);
+    directBlur(expected, width, depth, radius, TerrainGrid::SMOOTH_ITERATIONS);
+
+    double worst = 0.0;
+    for (int iz = 0; iz < depth; ++iz)
+    {
+      const float *row = grid.rowData(grid.physicalRow(iz));
+      for (int ix = 0; ix < width; ++ix)
+        worst = std::max(worst, static_cast<double>(std::fabs(row[ix] - expected[iz * width + ix])));
+    }
+    if (std::memcmp(grid.rowData(depth), grid.rowData(0), width * sizeof(float)) != 0)
+      mirrorOk = false;
+    return worst;
+  }
+}
+
+bool checkNoiseBatch()
+{
+  // 1e-6 per unit of term amplitude (TerrainNoise.h); no pattern's amplitudes sum past 3
+  const double bound = 3e-6;
+  // Inputs stay within |z * freq| < 1e5 for the highest frequency, 0.48
+  const float zLimit = 1e5f / 0.48f;
+
+  std::mt19937 rng(20240611u);
+  std::uniform_real_distribution<float> wide(-zLimit, zLimit);
+  std::uniform_real_distribution<float> near(-2000.0f, 2000.0f);
+  const float edges[] = {0.0f, -0.0f, 1e-30f, -1e-30f, 0.5f, -0.5f, 1.0f, -1.0f, zLimit, -zLimit,
+                         std::nextafter(zLimit, 0.0f), 3.14159265f, 1024.0f, -1024.0f, 65536.0f};
+  const int edgeCount = static_cast<int>(sizeof(edges) / sizeof(edges[0]));
+
+  std::vector<unsigned int> seeds = {0u, 1u, 7u, 999u, 1000u, 123456789u, 4294967295u};
+  for (int i = 0; i < 64; ++i)
+    seeds.push_back(rng());
+
+  double worst = 0.0;
+  long samples = 0;
+  bool batchInvariant = true;
+  std::vector<float> z;
+  std::vector<float> out;
+  for (unsigned int seed : seeds)
+  {
+    const NoiseParams params = NoiseParams::fromSeed(seed);
+    z.assign(edges, edges + edgeCount);
+    for (int i = 0; i < 2048; ++i)
+      z.push_back(i % 2 ? wide(rng) : near(rng));
+    out.resize(z.size());
+    sampleNoiseBatch(params, z.data(), static_cast<int>(z.size()), out.data());
+    for (size_t i = 0; i < z.size(); ++i)
+      worst = std::max(worst, static_cast<double>(std::fabs(out[i] - sampleNoiseReference(z[i], seed))));
+    samples += static_cast<long>(z.size());
+
+    // Short batches exercise the tail path; each value must match the long batch bit for bit
+    for (int count = 1; count <= 17; ++count)
+    {
+      for (int first = 0; first + count <= 40; first += count)
+      {
+        float part[17];
+        sampleNoiseBatch(params, z.data() + first, count, part);
+        if (std::memcmp(part, out.data() + first, count * sizeof(float)) != 0)
+          batchInvariant = false;
+      }
+    }
+  }
+
+  bool ok = report("noise batch:      ", worst, bound);
+  std::cout << "                  " << samples << " samples, " << seeds.size() << " seeds; batch tails "
+            << (batchInvariant ? "match the long batch" : "DIFFER FROM THE LONG BATCH") << std::endl;
+  return ok && batchInvariant;
+}
+
+bool checkSmoothing()
+{
+  // Differences come from summation order only: the direct blur adds in float, the running
+  // sums in double
+  const double bound = 1e-5;
+
+  // The render grid's spacing with the default 3x3 box, and a corridor-like fine grid with
+  // the wider box that matches it (5x finer, radius 7)
+  struct Config
+  {
+    int width;
+    int depth;
+    float scale;
+    int radius;
+  };
+  const Config configs[] = {{48, 200, 2.0f, TerrainGrid::SMOOTH_RADIUS}, {40, 160, 0.4f, 7}};
+  // Shifts that wrap the ring several times, both ways, including a regenerating one
+  const int shifts[] = {1, 7, 13, -5, 29, -31, 60, 3, -2, 150, 17, 41, -90, 9};
+  const unsigned int seed = 4242u;
+  const float heightScale = 3.5f;
+
+  double worst = 0.0;
+  bool mirrorOk = true;
+  int windows = 0;
+  for (const Config &config : configs)
+  {
+    TerrainGrid grid;
+    grid.setSmoothRadius(config.radius);
+    grid.setLateralDetail(lateralDetail);
+    grid.init(config.width, config.depth, config.scale, heightScale, seed);
+    worst = std::max(worst, smoothingError(grid, seed, heightScale, config.radius, mirrorOk));
+    windows++;
+    for (int shift : shifts)
+    {
+      TerrainGrid::RowRanges dirty;
+      grid.streamRows(shift, dirty);
+      worst = std::max(worst, smoothingError(grid, seed, heightScale, config.radius, mirrorOk));
+      windows++;
+    }
+  }
+
+  bool ok = report("smoothing:        ", worst, bound);
+  std::cout << "                  " << windows << " windows after streaming; mirrored row "
+            << (mirrorOk ? "matches row 0" : "DIFFERS FROM ROW 0") << std::endl;
+  return ok && mirrorOk;
+}
+
+bool checkQuantized()
+{
+  const int Q = TerrainGrid::QUANT_BLOCK;
+  // 129 columns leave a one-column block on the +X edge; heightScale 0 makes every block flat
+  struct Config
+  {
+    float heightScale;
+    bool detail;
+  };
+  const Config configs[] = {{3.5f, true}, {3.5f, false}, {0.0f, false}};
+  const int shifts[] = {Q, 3 * Q, -2 * Q, 5 * Q, -Q, 9 * Q, -7 * Q};
+  const unsigned int seed = 777u;
+  const int width = 129;
+  const int depth = 160;
+  const float scale = 2.0f;
+
+  double worstRatio = 0.0;    // error / bound, over every vertex and point
+  double worstVertex = 0.0;   // metres
+  double worstExtreme = 0.0;  // metres, at the lowest and highest vertex of each block
+  double worstPoint = 0.0;    // metres, getHeight between vertices
+  long vertices = 0;
+  long extremes = 0;
+  std::mt19937 rng(99u);
+  std::vector<TerrainVertex> exactRow(width);
+  std::vector<TerrainVertex> quantRow(width);
+
+  for (const Config &config : configs)
+  {
+    TerrainGrid exact;
+    TerrainGrid quant;
+    quant.setRepresentation(TerrainGrid::Representation::Quantized);
+    for (TerrainGrid *grid : {&exact, &quant})
+    {
+      if (config.detail)
+        grid->setLateralDetail(lateralDetail);
+      grid->init(width, depth, scale, config.heightScale, seed);
+    }
+
+    for (int step = 0; step <= static_cast<int>(sizeof(shifts) / sizeof(shifts[0])); ++step)
+    {
+      if (step > 0)
+      {
+        TerrainGrid::RowRanges dirty;
+        exact.streamRows(shifts[step - 1], dirty);
+        quant.streamRows(shifts[step - 1], dirty);
+      }
+      if (config.detail && step % 2 == 1)
+      {
+        // Craters give some blocks a much wider height range than their neighbours
+        TerrainGrid::Edit edit;
+        edit.x = std::uniform_real_distribution<float>(exact.getMinX(), exact.getMaxX())(rng);
+        edit.z = std::uniform_real_distribution<float>(exact.getMinZ(), exact.getMaxZ())(rng);
+        edit.radius = 6.0f;
+        edit.depth = 1.0f;
+        TerrainGrid::CellRect changed;
+        exact.deform(edit, changed);
+        quant.deform(edit, changed);
+      }
+
+      // Each block's range from the float heights; blocks follow physical rows
+      const int blockCols = (width + Q - 1) / Q;
+      std::vector<float> lo(depth / Q * blockCols, std::numeric_limits<float>::max());
+      std::vector<float> hi(lo.size(), std::numeric_limits<float>::lowest());
+      std::vector<float> exactHeights(width * depth);
+      std::vector<float> quantHeights(width * depth);
+      for (int iz = 0; iz < depth; ++iz)
+      {
+        exact.buildRowVertices(iz, exactRow.data());
+        quant.buildRowVertices(iz, quantRow.data());
+        for (int ix = 0; ix < width; ++ix)
+        {
+          exactHeights[iz * width + ix] = exactRow[ix].py;
+          quantHeights[iz * width + ix] = quantRow[ix].py;
+          const int block = quant.physicalRow(iz) / Q * blockCols + ix / Q;
+          lo[block] = std::min(lo[block], exactRow[ix].py);
+          hi[block] = std::max(hi[block], exactRow[ix].py);
+        }
+      }
+
+      // The stated bound, plus a few float roundings of the decode itself
+      auto boundAt = [&](int ix, int iz)
+      {
+        const int block = quant.physicalRow(iz) / Q * blockCols + ix / Q;
+        const float magnitude = std::max(std::fabs(lo[block]), std::fabs(hi[block]));
+        return (hi[block] - lo[block]) / 131070.0 + 4.0 * std::numeric_limits<float>::epsilon() * magnitude;
+      };
+
+      for (int iz = 0; iz < depth; ++iz)
+      {
+        for (int ix = 0; ix < width; ++ix)
+        {
+          const float h = exactHeights[iz * width + ix];
+          const double error = std::fabs(quantHeights[iz * width + ix] - h);
+          const double bound = boundAt(ix, iz);
+          worstVertex = std::max(worstVertex, error);
+          worstRatio = std::max(worstRatio, bound > 0.0 ? error / bound : (error > 0.0 ? 1e30 : 0.0));
+          const int block = quant.physicalRow(iz) / Q * blockCols + ix / Q;
+          if (h == lo[block] || h == hi[block])
+          {
+            worstExtreme = std::max(worstExtreme, error);
+            extremes++;
+          }
+          vertices++;
+        }
+      }
+
+      // Between vertices the error is a blend of the four corners' errors
+      std::uniform_real_distribution<float> px(exact.getMinX(), exact.getMaxX());
+      std::uniform_real_distribution<float> pz(exact.getMinZ(), exact.getMaxZ());
+      for (int i = 0; i < 2000; ++i)
+      {
+        const float x = px(rng);
+        const float z = pz(rng);
+        const int ix = std::min(static_cast<int>((x - exact.getMinX()) / scale), width - 2);
+        const int iz = std::min(static_cast<int>((z - exact.getMinZ()) / scale), depth - 2);
+        const double bound = std::max(std::max(boundAt(ix, iz), boundAt(ix + 1, iz)), std::max(boundAt(ix, iz + 1), boundAt(ix + 1, iz + 1)));
+        const double error = std::fabs(quant.getHeight(x, z) - exact.getHeight(x, z));
+        worstPoint = std::max(worstPoint, error);
+        worstRatio = std::max(worstRatio, bound > 0.0 ? error / bound : (error > 0.0 ? 1e30 : 0.0));
+      }
+    }
+  }
+
+  // Reported as a fraction of each height's own bound, which varies from block to block
+  bool ok = report("quantized:        ", worstRatio, 1.0);
+  std::cout << "                  of the per-block bound; " << vertices << " vertices, max " << worstVertex << " m; "
+            << extremes << " block extremes, max " << worstExtreme << " m; points max " << worstPoint << " m" << std::endl;
+  return ok;
+}
+
+bool checkRaycast()
+{
+  // Both solve the same bilinear surface; the march's float heights and bisection limit the
+  // agreement
+  const double bound = 1e-3;
+  const float step = 2.0f / 64.0f;
+
+  std::mt19937 rng(5150u);
+  TerrainGrid grid;
+  buildRaycastGrid(grid, rng);
+  const std::vector<Ray> rays = randomRays(grid, rng, 4000);
+
+  double worst = 0.0;
+  int hits = 0;
+  int misses = 0;
+  int grazing = 0;
+  int disagreements = 0;
+  for (const Ray &ray : rays)
+  {
+    float pyramidDist = 0.0f;
+    float marchDist = 0.0f;
+    float clearance = 0.0f;
+    const bool pyramidHit = grid.raycast(ray.origin, ray.dir, ray.maxDist, pyramidDist);
+    const bool marchHit = marchRay(grid, ray, step, marchDist, clearance);
+    if (pyramidHit && marchHit && std::fabs(pyramidDist - marchDist) <= bound)
+    {
+      worst = std::max(worst, static_cast<double>(std::fabs(pyramidDist - marchDist)));
+      hits++;
+    }
+    else if (!pyramidHit && !marchHit)
+    {
+      misses++;
+    }
+    else if (clearance < 1e-3f)
+    {
+      // The ray only grazes the surface, and the march can step over the touch
+      grazing++;
+    }
+    else
+    {
+      disagreements++;
+    }
+  }
+
+  bool ok = report("raycast:          ", worst, bound);
+  std::cout << "                  " << rays.size() << " rays: " << hits << " hits, " << misses << " misses, " << grazing
+            << " grazing, " << disagreements << " disagree with a march of " << step << " m steps" << std::endl;
+  return ok && disagreements == 0;
+}
+
+void benchNoise()
+{
+  // A render window's column of rows, 2 m apart, called repeatedly
+  const int count = 4093;
+  const int calls = 500;
+  std::vector<float> z(count);
+  std::vector<float> out(count);
+  for (int i = 0; i < count; ++i)
+    z[i] = (i - count / 2) * 2.0f + 1000.0f;
+
+  std::cout << "noise pattern   batch Msamples/s   reference Msamples/s   speedup" << std::endl;
+  for (int pattern = 0; pattern < NoiseParams::PATTERN_COUNT; ++pattern)
+  {
+    // Seeds past 10^9 use all four phase offsets
+    const unsigned int seed = 1234567000u + pattern;
+    const NoiseParams params = NoiseParams::fromSeed(seed);
+    const double batchSeconds = bestTime([&]
+                                         {
+                                           for (int call = 0; call < calls; ++call)
+                                             sampleNoiseBatch(params, z.data(), count, out.data()); });
+    volatile float sink = out[count / 2];
+    const double referenceSeconds = bestTime([&]
+                                             {
+                                               float sum = 0.0f;
+                                               for (int call = 0; call < calls; ++call)
+                                                 for (int i = 0; i < count; ++i)
+                                                   sum += sampleNoiseReference(z[i], seed);
+                                               sink = sum; });
+    (void)sink;
+
+    const double samples = static_cast<double>(count) * calls;
+    const double batchRate = samples / batchSeconds * 1e-6;
+    const double referenceRate = samples / referenceSeconds * 1e-6;
+    std::cout << std::fixed << std::setprecision(1) << std::setw(13) << pattern << std::setw(21) << batchRate
+              << std::setw(23) << referenceRate << std::setw(9) << batchRate / referenceRate << "x" << std::defaultfloat << std::endl;
+  }
+}
+
+void benchRaycast()
+{
+  std::mt19937 rng(5150u);
+  TerrainGrid grid;
+  buildRaycastGrid(grid, rng);
+  const std::vector<Ray> rays = randomRays(grid, rng, 4000);
+  // A quarter cell per step, bisected on the hit: what callers did before raycast existed
+  const float step = grid.getScale() / 4.0f;
+
+  int hits = 0;
+  const double pyramidSeconds = bestTime([&]
+                                         {
+                                           hits = 0;
+                                           for (const Ray &ray : rays)
+                                           {
+                                             float dist;
+                                             hits += grid.raycast(ray.origin, ray.dir, ray.maxDist, dist);
+                                           } });
+  int marchHits = 0;
+  const double marchSeconds = bestTime([&]
+                                       {
+                                         marchHits = 0;
+                                         for (const Ray &ray : rays)
+                                         {
+                                           float dist;
+                                           float clearance;
+                                           marchHits += marchRay(grid, ray, step, dist, clearance);
+                                         } });
+
+  const double n = static_cast<double>(rays.size());
+  std::cout << "raycast           us per ray   hits" << std::endl
+            << std::fixed << std::setprecision(2)
+            << "  pyramid     " << std::setw(16) << pyramidSeconds / n * 1e6 << std::setw(7) << hits << std::endl
+            << "  march " << std::setw(4) << step << " m" << std::setw(16) << marchSeconds / n * 1e6 << std::setw(7) << marchHits << std::endl
+            << "  speedup     " << std::setw(15) << marchSeconds / pyramidSeconds << "x" << std::defaultfloat << std::endl;
+}
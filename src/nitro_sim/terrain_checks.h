@@ -0,0 +1,28 @@
+#ifndef NITRO_SIM_TERRAIN_CHECKS_H
+#define NITRO_SIM_TERRAIN_CHECKS_H
+
+// Checks of the terrain fast paths against straightforward references, run by
+// nitro_sim_cli --check. Each prints one line with the error it found and returns false when
+// the error exceeds the stated bound.
+
+// sampleNoiseBatch against sampleNoiseReference over random and edge inputs, all patterns,
+// every tail length
+bool checkNoiseBatch();
+// TerrainGrid's running-sum smoothing against a direct (2r+1)^2 box blur of the whole window,
+// after streaming has wrapped the row ring; also that the mirrored row matches row 0
+bool checkSmoothing();
+// Quantized heights against the float Grid: every vertex (as the mesh build reads it) within
+// its block's stated bound, block extremes included, and getHeight at random points
+bool checkQuantized();
+// TerrainGrid::raycast against a fine march of getHeight along random rays: same hit or miss,
+// same distance
+bool checkRaycast();
+
+// Benchmarks, run by nitro_sim_cli --bench; each prints a short table
+
+// Throughput of each pattern's batch kernel against the per-sample scalar reference
+void benchNoise();
+// TerrainGrid::raycast against marching getHeight at a quarter cell per step
+void benchRaycast();
+
+#endif